@@ -0,0 +1,24 @@
+bdd_reduce.o: bdd_reduce.c bdd_reduce.h my_hash.h
+main.o: main.c solver.h vec.h obdd.h trie.h
+my_hash.o: my_hash.c my_def.h my_hash.h
+obdd.o: obdd.c my_def.h obdd.h
+solver.o: solver.c solver.h vec.h obdd.h trie.h
+trie.o: trie.c my_def.h trie.h
+bdd_reduce.op: bdd_reduce.c bdd_reduce.h my_hash.h
+main.op: main.c solver.h vec.h obdd.h trie.h
+my_hash.op: my_hash.c my_def.h my_hash.h
+obdd.op: obdd.c my_def.h obdd.h
+solver.op: solver.c solver.h vec.h obdd.h trie.h
+trie.op: trie.c my_def.h trie.h
+bdd_reduce.od: bdd_reduce.c bdd_reduce.h my_hash.h
+main.od: main.c solver.h vec.h obdd.h trie.h
+my_hash.od: my_hash.c my_def.h my_hash.h
+obdd.od: obdd.c my_def.h obdd.h
+solver.od: solver.c solver.h vec.h obdd.h trie.h
+trie.od: trie.c my_def.h trie.h
+bdd_reduce.or: bdd_reduce.c bdd_reduce.h my_hash.h
+main.or: main.c solver.h vec.h obdd.h trie.h
+my_hash.or: my_hash.c my_def.h my_hash.h
+obdd.or: obdd.c my_def.h obdd.h
+solver.or: solver.c solver.h vec.h obdd.h trie.h
+trie.or: trie.c my_def.h trie.h
@@ -882,6 +882,7 @@ void solver_setnvars(solver* s,int n)
         s->sublevels[var] = 0;
 #endif /*NONBLOCKING*/
         s->tags     [var] = l_Undef;
+        s->cache    [var] = NULL;
 #ifdef CUTSETCACHE
         s->cutwidth [var] = 0;
         s->cutsets  [var] = NULL;
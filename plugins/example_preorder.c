@@ -0,0 +1,33 @@
+/*
+ * Example pre-order plugin, scoring each state by its Hamming distance to the closest belief
+ * Build it with the belief_rev CMake project, then run belief_rev with --preorder path/to/libexample_preorder.so
+ */
+
+#include "preorder_plugin.h"
+
+uint32_t belief_preorder_version(void) {
+    return BELIEF_PREORDER_ABI_VERSION;
+}
+
+void belief_preorder_score(const uint64_t* states, uint64_t state_count, const uint64_t* beliefs,
+        uint64_t belief_count, uint64_t state_length, uint64_t word_count, uint64_t* scores) {
+    (void) state_length;
+
+    for (uint64_t i = 0; i < state_count; ++i) {
+        const uint64_t* state = states + i * word_count;
+
+        uint64_t best = UINT64_MAX;
+        for (uint64_t j = 0; j < belief_count && best != 0; ++j) {
+            const uint64_t* belief = beliefs + j * word_count;
+
+            uint64_t distance = 0;
+            for (uint64_t k = 0; k < word_count; ++k) {
+                distance += __builtin_popcountll(state[k] ^ belief[k]);
+            }
+            if (distance < best) {
+                best = distance;
+            }
+        }
+        scores[i] = best;
+    }
+}
@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <cassert>
 #include <climits>
@@ -9,9 +10,10 @@
 #include <functional>
 #include <iostream>
 #include <iterator>
-#include <map>
+#include <numeric>
 #include <omp.h>
 #include <sstream>
+#include <string>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/wait.h>
@@ -20,33 +22,42 @@
 #include <vector>
 
 #include "belief.h"
+#include "distance.h"
+#include "file.h"
 #include "interactive.h"
+#include "mih.h"
+#include "minimal.h"
+#include "packed.h"
+#include "pivot.h"
+#include "preorder.h"
+#include "radius.h"
+#include "sat.h"
 #include "utils.h"
+#include "vertical.h"
 
 /*
  * This is an example preordering that one can write, if they desire something other than the hamming distance.
+ * Its body is in example_preorder_policy in src/preorder.h, so the specialised scan can inline it.
  * If you desire a specialization of this function for performance, see the README for details.
  */
 unsigned long example_preorder(
         const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set) {
-    if (state.size() < 3) {
-        return 2;
-    }
-    if (state[0]) {
-        return 0;
-    } else if (state[1]) {
-        return 1;
-    } else if (state[2]) {
-        return 4;
-    } else {
-        return 7;
-    }
+    return example_preorder_policy::score(state, belief_set);
 }
 
 //THIS IS WHERE THE PRE-ORDER IS ASSIGNED, CHANGE THIS IF YOU WANT A DIFFERENT PRE-ORDER
 std::function<unsigned long(const std::vector<bool>&, const std::vector<std::vector<bool>>&)>
         total_preorder = state_difference;
 
+//How much larger (in log2) the estimated model count must be than the radius 2 balls to pick the radius engine
+static constexpr double radius_engine_margin = 4.0;
+
+//Estimated log2 model count above which enumerating the formula is considered hopeless
+static constexpr double sat_engine_model_threshold = 24.0;
+
+//Largest belief count times belief length for which the per-belief totalizers are still worth building
+static constexpr unsigned long sat_engine_size_limit = 1ul << 20;
+
 //Helper function that determines if a given state satisfies the formula
 static bool satisfies(const std::vector<bool>& state,
         const std::vector<std::vector<int32_t>>& clause_list) noexcept {
@@ -83,9 +94,8 @@ static bool satisfies(const std::bitset<64>& state,
     return true;
 }
 
-//Generates all possible states given a clause list and the final belief length
-//This grabs the results output from the All-SAT solver, and brute-force pads each output up to belief_length bits
-std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int32_t>>& clause_list,
+//Helper function that exits if the formula references a variable the beliefs don't have
+static void check_formula_variables(const std::vector<std::vector<int32_t>>& clause_list,
         const unsigned long belief_length) noexcept {
     for (const auto& clause : clause_list) {
         for (const auto term : clause) {
@@ -96,59 +106,109 @@ std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int
             }
         }
     }
-    std::vector<std::vector<int32_t>> output_states;
+}
 
-#pragma omp critical(allsat)
-    {
-        const char* input_filename = ".tmp.input";
-        const char* output_filename = ".tmp.output";
+//Runs the All-SAT solver over the clause list, collecting the partial assignments it outputs
+//Each cube only lists the variables it fixes, so an empty cube means every assignment is a model
+//Every call gets its own temporary files, so batch workers can run the solver at the same time
+//The solver exits with 0 once it has enumerated every model, or 20 when the input is trivially unsatisfiable,
+//and anything else, such as being killed for running out of memory, leaves its output incomplete
+bool try_run_allsat(const std::vector<std::vector<int32_t>>& clause_list,
+        std::vector<std::vector<int32_t>>& output_states) noexcept {
+    static std::atomic<unsigned long> call_count{0};
+
+    output_states.clear();
+
+    const std::string suffix
+            = "." + std::to_string(getpid()) + "." + std::to_string(call_count++);
+    const std::string input_name = ".tmp.input" + suffix;
+    const std::string output_name = ".tmp.output" + suffix;
+    const char* input_filename = input_name.c_str();
+    const char* output_filename = output_name.c_str();
+
+    if (access(input_filename, F_OK) == -1) {
+        creat(input_filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    }
+    if (access(output_filename, F_OK) == -1) {
+        creat(output_filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    }
 
-        if (access(input_filename, F_OK) == -1) {
-            creat(input_filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+    {
+        std::ofstream ofs{input_filename, std::ios_base::out | std::ios_base::trunc};
+        if (!ofs) {
+            std::cerr << "Unable to open output file\n";
+            exit(EXIT_FAILURE);
         }
-        if (access(output_filename, F_OK) == -1) {
-            creat(output_filename, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+
+        for (const auto& clause : clause_list) {
+            std::copy(clause.cbegin(), clause.cend(), std::ostream_iterator<int32_t>(ofs, " "));
+            ofs << "0\n";
         }
+    }
 
-        {
-            std::ofstream ofs{input_filename, std::ios_base::out | std::ios_base::trunc};
-            if (!ofs) {
-                std::cerr << "Unable to open output file\n";
-                exit(EXIT_FAILURE);
-            }
+    const std::string command = "./minisat_all/bdd_minisat_all_release " + input_name + " "
+            + output_name + " >/dev/null 2>&1";
+    const int status = system(command.c_str());
 
-            for (const auto& clause : clause_list) {
-                std::copy(clause.cbegin(), clause.cend(), std::ostream_iterator<int32_t>(ofs, " "));
-                ofs << "0\n";
-            }
-        }
+    if (status == -1 || !WIFEXITED(status)
+            || (WEXITSTATUS(status) != 0 && WEXITSTATUS(status) != 20)) {
+        unlink(input_filename);
+        unlink(output_filename);
+        return false;
+    }
 
-        system("./minisat_all/bdd_minisat_all_release .tmp.input .tmp.output >/dev/null 2>&1");
+    std::ifstream ifs{output_filename};
+    if (!ifs) {
+        std::cerr << "Unable to open results file\n";
+        exit(EXIT_FAILURE);
+    }
 
-        std::ifstream ifs{output_filename};
-        if (!ifs) {
-            std::cerr << "Unable to open results file\n";
-            exit(EXIT_FAILURE);
+    for (std::string line; std::getline(ifs, line);) {
+        if (line.empty()) {
+            continue;
         }
+        std::istringstream iss{std::move(line)};
 
-        for (std::string line; std::getline(ifs, line);) {
-            std::istringstream iss{std::move(line)};
+        std::vector<int32_t> clause_tokens;
 
-            std::vector<int32_t> clause_tokens;
+        clause_tokens.assign(
+                std::istream_iterator<int32_t>(iss), std::istream_iterator<int32_t>());
+        clause_tokens.erase(std::remove(clause_tokens.begin(), clause_tokens.end(), 0),
+                clause_tokens.end());
+        clause_tokens.shrink_to_fit();
 
-            clause_tokens.assign(
-                    std::istream_iterator<int32_t>(iss), std::istream_iterator<int32_t>());
-            clause_tokens.erase(std::remove(clause_tokens.begin(), clause_tokens.end(), 0),
-                    clause_tokens.end());
-            clause_tokens.shrink_to_fit();
+        output_states.emplace_back(std::move(clause_tokens));
+    }
+    ifs.close();
 
-            if (clause_tokens.empty()) {
-                continue;
-            }
+    unlink(input_filename);
+    unlink(output_filename);
 
-            output_states.emplace_back(std::move(clause_tokens));
-        }
+    return true;
+}
+
+std::vector<std::vector<int32_t>> run_allsat(
+        const std::vector<std::vector<int32_t>>& clause_list) noexcept {
+    std::vector<std::vector<int32_t>> output_states;
+    if (!try_run_allsat(clause_list, output_states)) {
+        std::cerr << "All-SAT solver failed\n";
+        exit(EXIT_FAILURE);
     }
+    return output_states;
+}
+
+//Generates all possible states given a clause list and the final belief length
+//This grabs the results output from the All-SAT solver, and brute-force pads each output up to belief_length bits
+std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int32_t>>& clause_list,
+        const unsigned long belief_length) noexcept {
+    check_formula_variables(clause_list, belief_length);
+
+    auto output_states = run_allsat(clause_list);
+
+    //A formula with no constraints produces a single empty cube, which has nothing to pad from
+    output_states.erase(std::remove_if(output_states.begin(), output_states.end(),
+                                [](const auto& clause) { return clause.empty(); }),
+            output_states.end());
 
     const auto abs_cmp = [](const auto a, const auto b) { return std::abs(a) < std::abs(b); };
 
@@ -190,195 +250,497 @@ std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int
 }
 
 //Caluclate the hamming distance between a state and the set of beliefs
+//The scan stops early once an exact match is found, since nothing can be closer
 unsigned long state_difference(
         const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set) {
     unsigned long min_dist = ULONG_MAX;
+    bool exact_match = false;
 
-#pragma omp parallel for reduction(min : min_dist) schedule(static)
+#pragma omp parallel for reduction(min : min_dist) schedule(static) shared(exact_match)
     for (auto it = belief_set.cbegin(); it < belief_set.cend(); ++it) {
         assert(state.size() == it->size());
 
+        bool scan_done;
+#pragma omp atomic read
+        scan_done = exact_match;
+        if (scan_done) {
+            continue;
+        }
+
         unsigned long count = 0;
 #pragma omp simd reduction(+ : count)
         for (unsigned long i = 0; i < it->size(); ++i) {
             count += (*it)[i] ^ state[i];
         }
+        if (count == 0) {
+#pragma omp atomic write
+            exact_match = true;
+        }
         min_dist = std::min(min_dist, count);
     }
 
     return min_dist;
 }
 
-//Same as the other hamming distance formula, but uses a bitset for MUCH faster evaluation
-//Must be different name since overloading functions messes with function comparisons in order to actually call this function
-unsigned long hamming(
-        const std::bitset<512>& state, const std::vector<std::bitset<512>>& belief_set) noexcept {
-    unsigned long min_dist = ULONG_MAX;
+//Runs the All-SAT solver on the formula and packs the cubes it outputs, exiting if there are none
+static packed_states formula_cubes(
+        const std::vector<std::vector<int32_t>>& formula, const unsigned long state_length) noexcept {
+    check_formula_variables(formula, state_length);
 
-#pragma omp parallel for reduction(min : min_dist) schedule(static)
-    for (auto it = belief_set.cbegin(); it < belief_set.cend(); ++it) {
-        assert(state.size() == it->size());
-        min_dist = std::min(min_dist, (state ^ *it).count());
+    const auto cubes = run_allsat(formula);
+    if (cubes.empty()) {
+        std::cerr << "Formula is unsatisfiable\n";
+        exit(EXIT_FAILURE);
     }
 
-    return min_dist;
+    report_stream() << "Generated cube count: " << cubes.size() << "\n";
+
+    return pack_cubes(cubes, state_length);
 }
 
-unsigned long pd_hamming(const std::vector<bool>& state,
-        const std::vector<std::vector<bool>>& belief_set,
-        const std::unordered_map<int32_t, unsigned long>& orderings) {
-    unsigned long min_dist = ULONG_MAX;
+//Applies one of the set-inclusion operators to the formula's cubes
+static packed_states operator_revision(const revision_operator op, const packed_states& formula,
+        const packed_states& beliefs) noexcept {
+    switch (op) {
+        case revision_operator::SATOH:
+            return satoh_revision(formula, beliefs);
+        case revision_operator::WEBER:
+            return weber_revision(formula, beliefs);
+        default:
+            std::cerr << "Operator does not work on cubes\n";
+            exit(EXIT_FAILURE);
+    }
+}
 
-#pragma omp parallel for reduction(min : min_dist) schedule(static)
-    for (auto it = belief_set.cbegin(); it < belief_set.cend(); ++it) {
-        assert(state.size() == it->size());
+//Expands every row into the full states it covers, where rows that aren't cubes are already full states
+static std::vector<std::vector<bool>> expand_cubes(const packed_states& cubes) noexcept {
+    std::vector<std::vector<bool>> output;
+    for (unsigned long i = 0; i < cubes.size; ++i) {
+        auto state = unpack_state(cubes, i);
+        if (!cubes.is_cubes()) {
+            output.emplace_back(std::move(state));
+            continue;
+        }
 
-        unsigned long count = 0;
-#pragma omp simd reduction(+ : count)
-        for (unsigned long i = 0; i < it->size(); ++i) {
-            count += ((*it)[i] ^ state[i])
-                    * ((i + 1 > orderings.size()) ? 1 : orderings.find(i + 1)->second);
+        std::vector<unsigned long> free_bits;
+        for (unsigned long j = 0; j < cubes.state_length; ++j) {
+            if (!((cubes.care_row(i)[j / 64] >> (j % 64)) & 1)) {
+                free_bits.push_back(j);
+            }
+        }
+        for (uint64_t mask = 0; mask < (1ull << free_bits.size()); ++mask) {
+            for (unsigned long k = 0; k < free_bits.size(); ++k) {
+                state[free_bits[k]] = (mask >> k) & 1;
+            }
+            output.push_back(state);
         }
-        min_dist = std::min(min_dist, count);
     }
-
-    return min_dist;
+    return output;
 }
 
-unsigned long pd_hamming_bitset(const std::bitset<512>& state,
-        const std::vector<std::bitset<512>>& belief_set,
-        const std::unordered_map<int32_t, unsigned long>& orderings) noexcept {
-    unsigned long min_dist = ULONG_MAX;
+//Hamming revision over the formula's All-SAT cubes
+//The cubes are scored against the beliefs as they are, and only the optimal ones are completed
+//Returns full states for full state beliefs, and cubes for belief cubes
+static packed_states cube_revision(
+        const packed_states& beliefs, const packed_states& cube_bits) noexcept {
+    const auto collector = collect_min_distances(cube_bits, beliefs);
 
-#pragma omp parallel for reduction(min : min_dist) schedule(static)
-    for (auto it = belief_set.cbegin(); it < belief_set.cend(); ++it) {
-        assert(state.size() == it->size());
+    report_stream() << collector.best << "\n";
 
-        unsigned long count = 0;
-        const auto result = (state ^ *it);
+    return complete_from_beliefs(cube_bits, collector.indices, beliefs, collector.best);
+}
 
-        for (auto i = 0; i < 512; ++i) {
-            count += result[i] * ((i + 1lu > orderings.size()) ? 1 : orderings.find(i + 1)->second);
+//Finds the closest formula states by enumerating every model of the formula and scoring each one
+//Original beliefs must already be sorted
+static std::vector<std::vector<bool>> enumerate_revision(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings,
+        const revision_options& options) noexcept {
+    //Hamming distance can be scored on the solver's cubes directly, so only the optimal cubes get expanded
+    if (active_preorder() == preorder_kind::HAMMING && orderings.empty()
+            && !options.use_mih_index && !options.use_vertical_layout && !options.pivot_count) {
+        const auto completed = cube_revision(
+                pack_states(original_beliefs), formula_cubes(formula, original_beliefs.front().size()));
+
+        std::vector<std::vector<bool>> revised_beliefs;
+        revised_beliefs.reserve(completed.size);
+        for (unsigned long i = 0; i < completed.size; ++i) {
+            revised_beliefs.emplace_back(unpack_state(completed, i));
         }
+        std::sort(revised_beliefs.begin(), revised_beliefs.end());
+        revised_beliefs.erase(
+                std::unique(revised_beliefs.begin(), revised_beliefs.end()), revised_beliefs.end());
 
-        min_dist = std::min(min_dist, count);
+        return revised_beliefs;
     }
 
-    return min_dist;
-}
-
-//The main revision function
-//Original beliefs must contain equal length bit assignments representing the state of each variable
-//The formula must be in CNF format
-std::vector<std::vector<int32_t>> revise_beliefs(std::vector<std::vector<bool>>& original_beliefs,
-        const std::vector<std::vector<int32_t>>& formula,
-        const std::unordered_map<int32_t, unsigned long> orderings,
-        const char* output_file) noexcept {
     auto formula_states = generate_states(formula, original_beliefs.front().size());
     if (formula_states.empty()) {
         std::cerr << "Formula is unsatisfiable\n";
         exit(EXIT_FAILURE);
     }
 
-    std::cout << "Generated state size: " << formula_states.size() << "\n";
+    report_stream() << "Generated state size: " << formula_states.size() << "\n";
 
     std::vector<std::vector<bool>> revised_beliefs;
 
     if (!std::is_sorted(formula_states.begin(), formula_states.end())) {
         std::sort(formula_states.begin(), formula_states.end());
     }
-    if (!std::is_sorted(original_beliefs.begin(), original_beliefs.end())) {
-        std::sort(original_beliefs.begin(), original_beliefs.end());
-    }
 
-    std::cout << "Done sorting\n";
+    report_stream() << "Done sorting\n";
 
     std::set_intersection(formula_states.cbegin(), formula_states.cend(), original_beliefs.cbegin(),
             original_beliefs.cend(), std::back_inserter(revised_beliefs));
 
-    std::cout << "Done intersection\n";
+    report_stream() << "Done intersection\n";
 
     if (revised_beliefs.empty()) {
-        //Calculate distances and add stuff that way
-        std::multimap<unsigned long, std::vector<bool>> distance_map;
-
-        //Specialization of hamming distance to efficiently use bitsets
-        if (total_preorder == decltype(total_preorder)(state_difference)
-                && formula_states.front().size() <= 512) {
-            //512 bits because that is infeasible to compute
-            //Could do 256, but theoretically, I might be able to do that
-            std::vector<std::bitset<512>> formula_bits{
-                    formula_states.size(), {}, std::allocator<std::bitset<512>>()};
-            std::vector<std::bitset<512>> belief_bits;
-
-            belief_bits.reserve(original_beliefs.size());
-
-#pragma omp parallel shared(formula_bits, belief_bits)
-            {
-#pragma omp for schedule(static) nowait
-                for (auto it = formula_states.cbegin(); it < formula_states.cend(); ++it) {
-                    std::bitset<512> bs;
-                    for (unsigned int i = 0; i < 512; ++i) {
-                        bs[i] = (i < it->size()) ? (*it)[i] : false;
-                    }
-#pragma omp critical(form)
-                    formula_bits[formula_bits.size() - std::distance(it, formula_states.cend())]
-                            = std::move(bs);
-                }
-#pragma omp for schedule(static) nowait
-                for (auto it = original_beliefs.cbegin(); it < original_beliefs.cend(); ++it) {
-                    std::bitset<512> bs;
-                    for (unsigned int i = 0; i < 512; ++i) {
-                        bs[i] = (i < it->size()) ? (*it)[i] : false;
-                    }
-#pragma omp critical(bell)
-                    belief_bits.emplace_back(std::move(bs));
-                }
+        //Calculate distances, only keeping the states that reach the current minimum
+        min_collector collector;
+
+        //Specialization of hamming distance to efficiently use packed states
+        if (active_preorder() == preorder_kind::HAMMING && orderings.empty()) {
+            const auto formula_bits = pack_states(formula_states);
+            const auto belief_bits = pack_states(original_beliefs);
+
+            report_stream() << "Done conversion\n";
+
+            //The intersection was empty, so every formula state is at least 1 away from the beliefs
+            if (options.use_mih_index) {
+                const auto index = build_mih_index(belief_bits);
+
+                report_stream() << "Done indexing\n";
+
+                collector = mih_collect_min_distances(index, formula_bits, belief_bits, 1);
+            } else if (options.use_vertical_layout) {
+                const auto planes = build_vertical_beliefs(belief_bits);
+
+                report_stream() << "Done transposing\n";
+
+                collector = vertical_collect_min_distances(formula_bits, planes, 1);
+            } else if (options.pivot_count) {
+                const auto index = build_pivot_index(belief_bits, options.pivot_count);
+
+                report_stream() << "Done indexing\n";
+
+                double pruned_fraction = 0;
+                collector = pivot_collect_min_distances(index, formula_bits, 1, &pruned_fraction);
+
+                report_stream() << "Pivots pruned " << (100.0 * pruned_fraction)
+                          << "% of belief comparisons\n";
+            } else {
+                collector = collect_min_distances(formula_bits, belief_bits, 1);
             }
+        } else if (active_preorder() == preorder_kind::HAMMING) {
+            //Pd orderings are compiled into one mask per weight, so each pair is a few masked popcounts
+            const auto formula_bits = pack_states(formula_states);
+            const auto belief_bits = pack_states(original_beliefs);
+            const auto tiers = compile_tiers(orderings, formula_bits.state_length);
 
-            std::cout << "Done conversion\n";
+            report_stream() << "Done conversion\n";
 
-            for (unsigned int i = 0; i < formula_states.size(); ++i) {
-                if (orderings.empty()) {
-                    distance_map.emplace(hamming(formula_bits[i], belief_bits), formula_states[i]);
-                } else {
-                    distance_map.emplace(pd_hamming_bitset(formula_bits[i], belief_bits, orderings),
-                            formula_states[i]);
-                }
+            collector = collect_min_distances(formula_bits, belief_bits, 0, &tiers);
+        } else {
+            collector = collect_minimum(preorder_distances(formula_states, original_beliefs));
+        }
+
+        report_stream() << collector.best << "\n";
+
+        //Add all the beliefs that have the minimal distance from the original ones
+        //Indices are sorted so the output keeps the same order as the sorted formula states
+        std::sort(collector.indices.begin(), collector.indices.end());
+        revised_beliefs.reserve(collector.indices.size());
+        for (const auto i : collector.indices) {
+            revised_beliefs.push_back(formula_states[i]);
+        }
+    }
+
+
+    return revised_beliefs;
+}
+
+//Picks the engine to use when the caller left it up to revise_beliefs
+//Searching outward from the beliefs wins when the formula has far more models than the radius 2 balls hold
+//Otherwise the SAT search wins when the formula has too many models to enumerate, as long as the
+//per-belief totalizers stay a reasonable size
+static revision_engine choose_engine(const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings,
+        const bool allow_radius) noexcept {
+    if (active_preorder() != preorder_kind::HAMMING || !orderings.empty()) {
+        return revision_engine::ENUMERATE;
+    }
+    const auto belief_length = original_beliefs.front().size();
+    const auto model_estimate = estimate_model_count_log2(formula, belief_length);
+
+    if (allow_radius
+            && model_estimate >= ball_cost_log2(original_beliefs.size(), belief_length, 2)
+                            + radius_engine_margin) {
+        return revision_engine::RADIUS;
+    }
+    if (model_estimate >= sat_engine_model_threshold
+            && original_beliefs.size() * belief_length <= sat_engine_size_limit) {
+        return revision_engine::SAT;
+    }
+    return revision_engine::ENUMERATE;
+}
+
+//Runs the requested engine, falling back to enumeration when the faster engines can't produce an answer
+//Original beliefs must already be sorted
+static std::vector<std::vector<bool>> run_engine(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings,
+        const revision_options& options) noexcept {
+    const auto belief_length = original_beliefs.front().size();
+
+    std::vector<std::vector<bool>> revised_beliefs;
+
+    auto engine = (options.engine == revision_engine::AUTO)
+            ? choose_engine(original_beliefs, formula, orderings, true)
+            : options.engine;
+
+    if (engine == revision_engine::RADIUS) {
+        check_formula_variables(formula, belief_length);
+
+        //When chosen automatically, give up once the balls would cost more than enumerating the models
+        unsigned long max_radius = belief_length;
+        if (options.engine == revision_engine::AUTO) {
+            const auto model_estimate = estimate_model_count_log2(formula, belief_length);
+            max_radius = 0;
+            while (max_radius < belief_length
+                    && ball_cost_log2(original_beliefs.size(), belief_length, max_radius + 1)
+                            <= model_estimate) {
+                ++max_radius;
+            }
+        }
+
+        auto [distance, states] = radius_revision(
+                pack_states(original_beliefs), pack_cnf(formula, belief_length), max_radius);
+
+        if (states.empty()) {
+            report_stream() << "Radius search gave up at distance " << max_radius << "\n";
+            if (options.engine == revision_engine::AUTO) {
+                engine = choose_engine(original_beliefs, formula, orderings, false);
             }
         } else {
-            for (const auto& state : formula_states) {
-                if (orderings.empty()) {
-                    distance_map.emplace(total_preorder(state, original_beliefs), state);
-                } else {
-                    distance_map.emplace(pd_hamming(state, original_beliefs, orderings), state);
+            report_stream() << "Radius search found " << states.size() << " states\n";
+            report_stream() << distance << "\n";
+            revised_beliefs = std::move(states);
+        }
+    }
+
+    if (revised_beliefs.empty() && engine == revision_engine::SAT) {
+        check_formula_variables(formula, belief_length);
+
+        unsigned long distance;
+        std::vector<std::vector<bool>> states;
+        if (!sat_revision(original_beliefs, formula, distance, states)) {
+            //A failed call proves nothing about that distance, so only enumeration can still give the answer
+            if (options.engine != revision_engine::AUTO) {
+                std::cerr << "All-SAT solver failed during the SAT search at distance " << distance
+                          << "\n";
+                exit(EXIT_FAILURE);
+            }
+            report_stream() << "SAT search failed at distance " << distance << ", enumerating instead\n";
+        } else if (states.empty()) {
+            std::cerr << "Formula is unsatisfiable\n";
+            exit(EXIT_FAILURE);
+        } else {
+            report_stream() << distance << "\n";
+            revised_beliefs = std::move(states);
+        }
+    }
+
+    if (revised_beliefs.empty()) {
+        revised_beliefs = enumerate_revision(original_beliefs, formula, orderings, options);
+    }
+
+    return revised_beliefs;
+}
+
+//Revision when the formula leaves some variables unconstrained
+//The closest completion of a free variable always copies the belief it is compared against, so the
+//engine only runs on the constrained variables, and each optimal state then takes its free variables
+//from every belief it is closest to
+//Constrained holds the 1-based variables to keep, in increasing order
+static std::vector<std::vector<bool>> constrained_revision(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings, const revision_options& options,
+        const std::vector<int32_t>& constrained) noexcept {
+    const unsigned long constrained_count = constrained.size();
+
+    std::unordered_map<int32_t, int32_t> renamed;
+    for (unsigned long i = 0; i < constrained_count; ++i) {
+        renamed.emplace(constrained[i], i + 1);
+    }
+
+    std::vector<std::vector<int32_t>> compact_formula{formula};
+    for (auto& clause : compact_formula) {
+        for (auto& term : clause) {
+            term = (term > 0) ? renamed[term] : -renamed[-term];
+        }
+    }
+
+    std::unordered_map<int32_t, unsigned long> compact_orderings;
+    if (!orderings.empty()) {
+        for (unsigned long i = 0; i < constrained_count; ++i) {
+            const auto variable = constrained[i];
+            const auto it = orderings.find(variable);
+            compact_orderings.emplace(i + 1,
+                    (static_cast<unsigned long>(variable) > orderings.size()
+                            || it == orderings.end())
+                            ? 1
+                            : it->second);
+        }
+    }
+
+    std::vector<std::vector<bool>> projected_beliefs;
+    projected_beliefs.reserve(original_beliefs.size());
+    for (const auto& belief : original_beliefs) {
+        std::vector<bool> projected(constrained_count);
+        for (unsigned long i = 0; i < constrained_count; ++i) {
+            projected[i] = belief[constrained[i] - 1];
+        }
+        projected_beliefs.emplace_back(std::move(projected));
+    }
+
+    std::vector<std::vector<bool>> compact_beliefs{projected_beliefs};
+    std::sort(compact_beliefs.begin(), compact_beliefs.end());
+    compact_beliefs.erase(
+            std::unique(compact_beliefs.begin(), compact_beliefs.end()), compact_beliefs.end());
+
+    const auto compact_states
+            = run_engine(compact_beliefs, compact_formula, compact_orderings, options);
+    if (compact_states.empty()) {
+        return {};
+    }
+
+    //Find every (state, belief) pair at the minimum distance, indexed as state * belief count + belief
+    const auto state_bits = pack_states(compact_states);
+    const auto belief_bits = pack_states(projected_beliefs);
+    const unsigned long word_count = state_bits.word_count;
+    const unsigned long belief_count = belief_bits.size;
+
+    const auto tiers = compile_tiers(compact_orderings, constrained_count);
+
+    min_collector pairs;
+    std::atomic<unsigned long> shared_bound{ULONG_MAX};
+
+#pragma omp parallel
+    {
+        min_collector local;
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long i = 0; i < state_bits.size; ++i) {
+            for (unsigned long j = 0; j < belief_count; ++j) {
+                const auto bound = shared_bound.load(std::memory_order_relaxed);
+                const auto distance = (orderings.empty())
+                        ? bounded_distance(state_bits.row(i), belief_bits.row(j), word_count, bound)
+                        : bounded_tier_distance(
+                                state_bits.row(i), belief_bits.row(j), tiers, bound);
+                if (distance <= bound) {
+                    lower_shared_bound(shared_bound, distance);
+                    local.add(distance, i * belief_count + j);
                 }
             }
         }
 
-        //Grab every element whose key is equal to the lowest key in the map
-        const auto min_dist = distance_map.lower_bound(0)->first;
+#pragma omp critical(collector_merge)
+        pairs.merge(local);
+    }
 
-        std::cout << min_dist << "\n";
+    //Zero weight variables can put non-identical pairs at distance 0, but an exact match is the
+    //intersection with the formula, which takes priority like it does when enumerating
+    if (pairs.best == 0 && !orderings.empty()) {
+        std::vector<unsigned long> exact;
+        for (const auto index : pairs.indices) {
+            if (bounded_distance(state_bits.row(index / belief_count),
+                        belief_bits.row(index % belief_count), word_count, 0)
+                    == 0) {
+                exact.push_back(index);
+            }
+        }
+        if (!exact.empty()) {
+            pairs.indices = std::move(exact);
+        }
+    }
 
-        //Add all the beliefs that have the minimal distance from the original ones
-        const auto range = distance_map.equal_range(min_dist);
-        for (auto it = range.first; it != range.second; ++it) {
-            revised_beliefs.push_back(it->second);
+    std::vector<std::vector<bool>> revised_beliefs;
+    revised_beliefs.reserve(pairs.indices.size());
+    for (const auto index : pairs.indices) {
+        const auto& state = compact_states[index / belief_count];
+        std::vector<bool> completed{original_beliefs[index % belief_count]};
+        for (unsigned long i = 0; i < constrained_count; ++i) {
+            completed[constrained[i] - 1] = state[i];
+        }
+        revised_beliefs.emplace_back(std::move(completed));
+    }
+    std::sort(revised_beliefs.begin(), revised_beliefs.end());
+    revised_beliefs.erase(
+            std::unique(revised_beliefs.begin(), revised_beliefs.end()), revised_beliefs.end());
+
+    return revised_beliefs;
+}
+
+//Pointwise update, keeping the formula states closest to each belief and taking their union
+//Hamming distance works on the solver's cubes, and pd orderings on the enumerated formula states
+//Custom pre-orders are given each belief as a belief set of its own
+static std::vector<std::vector<bool>> update_revision(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings) noexcept {
+    const auto belief_length = original_beliefs.front().size();
+    const bool is_hamming = (active_preorder() == preorder_kind::HAMMING);
+
+    if (is_hamming && orderings.empty()) {
+        return expand_cubes(
+                pointwise_update(formula_cubes(formula, belief_length), pack_states(original_beliefs)));
+    }
+
+    const auto formula_states = generate_states(formula, belief_length);
+    if (formula_states.empty()) {
+        std::cerr << "Formula is unsatisfiable\n";
+        exit(EXIT_FAILURE);
+    }
+
+    report_stream() << "Generated state size: " << formula_states.size() << "\n";
+
+    if (is_hamming) {
+        const auto tiers = compile_tiers(orderings, belief_length);
+        return expand_cubes(pointwise_update(
+                pack_states(formula_states), pack_states(original_beliefs), &tiers));
+    }
+
+    std::vector<std::vector<bool>> revised_beliefs;
+    for (const auto& belief : original_beliefs) {
+        const std::vector<std::vector<bool>> single_belief{belief};
+
+        const auto collector = collect_minimum(preorder_distances(formula_states, single_belief));
+        for (const auto i : collector.indices) {
+            revised_beliefs.push_back(formula_states[i]);
         }
     }
+    return revised_beliefs;
+}
 
+//Prints the revised belief set, or writes it to the output file, then minimizes the printed formula if possible
+static std::vector<std::vector<int32_t>> report_revision(
+        const std::vector<std::vector<bool>>& revised_beliefs, const char* output_file) noexcept {
     assert(!revised_beliefs.empty());
 
     //We're done
-    std::cout << "Revised belief set:\n";
+    report_stream() << "Revised belief set:\n";
 
     if (verbose) {
         for (const auto& belief : revised_beliefs) {
             for (const auto b : belief) {
-                std::cout << b;
+                report_stream() << b;
             }
-            std::cout << "\n";
+            report_stream() << "\n";
         }
         for (const auto& belief : revised_beliefs) {
             for (unsigned long i = 0; i < belief.size(); ++i) {
@@ -386,9 +748,9 @@ std::vector<std::vector<int32_t>> revise_beliefs(std::vector<std::vector<bool>>&
                 if (!belief[i]) {
                     term *= -1;
                 }
-                std::cout << term << " ";
+                report_stream() << term << " ";
             }
-            std::cout << "\n";
+            report_stream() << "\n";
         }
     }
 
@@ -423,20 +785,20 @@ std::vector<std::vector<int32_t>> revise_beliefs(std::vector<std::vector<bool>>&
     return convert_to_num(revised_beliefs);
 
 minimize:
-    std::cout << "Minimization is possible\n";
+    report_stream() << "Minimization is possible\n";
 
-    std::cout << "Initial pre-minimized state size: " << revised_beliefs.size() << "\n";
+    report_stream() << "Initial pre-minimized state size: " << revised_beliefs.size() << "\n";
 
     auto minimized = minimize_output(convert_to_num(revised_beliefs));
     for (;;) {
         unsigned long old_size = minimized.size();
 
-        std::cout << "Minimized Size: " << old_size << "\n";
+        report_stream() << "Minimized Size: " << old_size << "\n";
         unsigned long long old_sum = 0;
         for (const auto& clause : minimized) {
             old_sum += clause.size();
         }
-        std::cout << "Average clause size: " << (old_sum / old_size) << "\n";
+        report_stream() << "Average clause size: " << (old_sum / old_size) << "\n";
 
         minimized = minimize_output(minimized);
 
@@ -448,13 +810,13 @@ minimize:
         if (old_size == minimized.size() && new_sum == old_sum) {
             minimized = minimize_output(minimized);
             //Print minimized
-            std::cout << "Minimized states:\n";
+            report_stream() << "Minimized states:\n";
             if (verbose) {
                 for (const auto& belief : minimized) {
                     for (const auto term : belief) {
-                        std::cout << term << " ";
+                        report_stream() << term << " ";
                     }
-                    std::cout << "\n";
+                    report_stream() << "\n";
                 }
             }
             print_formula_dnf(minimized);
@@ -468,6 +830,546 @@ minimize:
     return convert_to_num(revised_beliefs);
 }
 
+
+//Finds the formula states in the closest few distance layers, in a single scoring pass
+//Every state is scored, since a state that is not the closest can still land in a later layer
+//Original beliefs must already be sorted
+static std::vector<std::pair<unsigned long, std::vector<std::vector<bool>>>> layered_revision(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings,
+        const unsigned long layer_count) noexcept {
+    auto formula_states = generate_states(formula, original_beliefs.front().size());
+    if (formula_states.empty()) {
+        std::cerr << "Formula is unsatisfiable\n";
+        exit(EXIT_FAILURE);
+    }
+
+    report_stream() << "Generated state size: " << formula_states.size() << "\n";
+
+    if (!std::is_sorted(formula_states.begin(), formula_states.end())) {
+        std::sort(formula_states.begin(), formula_states.end());
+    }
+
+    std::vector<unsigned long> distances;
+    if (active_preorder() == preorder_kind::HAMMING) {
+        const auto formula_bits = pack_states(formula_states);
+        const auto belief_bits = pack_states(original_beliefs);
+
+        if (orderings.empty()) {
+            distances = min_distances(formula_bits, belief_bits);
+        } else {
+            const auto tiers = compile_tiers(orderings, formula_bits.state_length);
+            distances = min_distances(formula_bits, belief_bits, 0, &tiers);
+        }
+    } else {
+        distances = preorder_distances(formula_states, original_beliefs);
+    }
+
+    const auto collector = collect_layers(distances, layer_count);
+
+    std::vector<std::pair<unsigned long, std::vector<std::vector<bool>>>> output;
+    for (auto [distance, indices] : collector.layers) {
+        std::sort(indices.begin(), indices.end());
+
+        std::vector<std::vector<bool>> states;
+        states.reserve(indices.size());
+        for (const auto i : indices) {
+            states.push_back(formula_states[i]);
+        }
+        output.emplace_back(distance, std::move(states));
+    }
+
+    return output;
+}
+
+//Revises the beliefs with the operator, mode, and engine the options ask for, without reporting the result
+//Original beliefs must already be sorted
+static std::vector<std::vector<bool>> revise_states(
+        const std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long>& orderings,
+        const revision_options& options) noexcept {
+    const auto belief_length = original_beliefs.front().size();
+
+    //Variables the formula never mentions only need scoring when they have no weight to copy them with
+    std::vector<bool> is_constrained(belief_length, false);
+    for (const auto& clause : formula) {
+        for (const auto term : clause) {
+            is_constrained[std::abs(term) - 1] = true;
+        }
+    }
+    for (const auto& p : orderings) {
+        if (p.second == 0 && p.first > 0 && static_cast<unsigned long>(p.first) <= belief_length) {
+            is_constrained[p.first - 1] = true;
+        }
+    }
+    std::vector<int32_t> constrained;
+    for (unsigned long i = 0; i < belief_length; ++i) {
+        if (is_constrained[i]) {
+            constrained.push_back(i + 1);
+        }
+    }
+
+    std::vector<std::vector<bool>> revised_beliefs;
+
+    if (options.op != revision_operator::DALAL) {
+        revised_beliefs = expand_cubes(operator_revision(options.op,
+                formula_cubes(formula, belief_length), pack_states(original_beliefs)));
+        std::sort(revised_beliefs.begin(), revised_beliefs.end());
+        revised_beliefs.erase(
+                std::unique(revised_beliefs.begin(), revised_beliefs.end()), revised_beliefs.end());
+    } else if (options.update) {
+        revised_beliefs = update_revision(original_beliefs, formula, orderings);
+        std::sort(revised_beliefs.begin(), revised_beliefs.end());
+        revised_beliefs.erase(
+                std::unique(revised_beliefs.begin(), revised_beliefs.end()), revised_beliefs.end());
+    } else if (active_preorder() == preorder_kind::HAMMING
+            && !constrained.empty() && constrained.size() < belief_length) {
+        report_stream() << "Formula constrains " << constrained.size() << " of " << belief_length
+                  << " variables\n";
+        revised_beliefs
+                = constrained_revision(original_beliefs, formula, orderings, options, constrained);
+    } else {
+        revised_beliefs = run_engine(original_beliefs, formula, orderings, options);
+    }
+
+    return revised_beliefs;
+}
+
+//The main revision function
+//Original beliefs must contain equal length bit assignments representing the state of each variable
+//The formula must be in CNF format
+std::vector<std::vector<int32_t>> revise_beliefs(std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings, const char* output_file,
+        const revision_options& options) noexcept {
+    if (!std::is_sorted(original_beliefs.begin(), original_beliefs.end())) {
+        std::sort(original_beliefs.begin(), original_beliefs.end());
+    }
+
+    const auto belief_length = original_beliefs.front().size();
+
+    check_formula_variables(formula, belief_length);
+
+    if (options.layers > 1) {
+        const auto layers
+                = layered_revision(original_beliefs, formula, orderings, options.layers);
+
+        report_stream() << "Revised belief set:\n";
+
+        std::vector<std::vector<int32_t>> revised_terms;
+        std::ofstream ofs;
+        if (output_file) {
+            ofs.open(output_file);
+        }
+        for (const auto& [distance, states] : layers) {
+            const auto terms = convert_to_num(states);
+
+            report_stream() << "Layer at distance " << distance << " with " << states.size()
+                      << " states\n";
+
+            if (verbose) {
+                for (const auto& belief : states) {
+                    for (const auto b : belief) {
+                        report_stream() << b;
+                    }
+                    report_stream() << "\n";
+                }
+            }
+
+            if (output_file) {
+                ofs << "c distance " << distance << "\n";
+                for (const auto& clause : terms) {
+                    for (const auto term : clause) {
+                        ofs << term << " ";
+                    }
+                    ofs << "\n";
+                }
+            } else {
+                print_formula_dnf(terms);
+            }
+            revised_terms.insert(revised_terms.end(), terms.cbegin(), terms.cend());
+        }
+        return revised_terms;
+    }
+
+    return report_revision(revise_states(original_beliefs, formula, orderings, options), output_file);
+}
+
+//Prints the revised cubes, or writes them to the output file
+static std::vector<std::vector<int32_t>> report_terms(
+        const std::vector<std::vector<int32_t>>& revised_terms, const char* output_file) noexcept {
+    assert(!revised_terms.empty());
+
+    report_stream() << "Revised belief set:\n";
+
+    if (verbose) {
+        for (const auto& clause : revised_terms) {
+            for (const auto term : clause) {
+                report_stream() << term << " ";
+            }
+            report_stream() << "\n";
+        }
+    }
+
+    if (output_file) {
+        std::ofstream ofs{output_file};
+        for (const auto& clause : revised_terms) {
+            for (const auto term : clause) {
+                ofs << term << " ";
+            }
+            ofs << "\n";
+        }
+        return revised_terms;
+    }
+
+    print_formula_dnf(revised_terms);
+
+    return revised_terms;
+}
+
+//Reports a packed belief set, as cubes if it holds any and as full states otherwise
+static std::vector<std::vector<int32_t>> report_packed(
+        const packed_states& revised, const char* output_file) noexcept {
+    if (!revised.is_cubes()) {
+        return report_revision(expand_cubes(revised), output_file);
+    }
+
+    std::vector<std::vector<int32_t>> revised_terms;
+    revised_terms.reserve(revised.size);
+    for (unsigned long i = 0; i < revised.size; ++i) {
+        revised_terms.emplace_back(unpack_cube(revised, i));
+    }
+    std::sort(revised_terms.begin(), revised_terms.end());
+
+    return report_terms(revised_terms, output_file);
+}
+
+//Determines if the revision can score the belief cubes directly, rather than expanding them into full states
+static bool works_on_cubes(const std::unordered_map<int32_t, unsigned long>& orderings,
+        const revision_options& options) noexcept {
+    if (options.op != revision_operator::DALAL) {
+        return true;
+    }
+    return active_preorder() == preorder_kind::HAMMING && orderings.empty()
+            && !options.use_mih_index && !options.use_vertical_layout && !options.pivot_count
+            && options.layers == 1 && !options.update
+            && (options.engine == revision_engine::AUTO
+                    || options.engine == revision_engine::ENUMERATE);
+}
+
+//Revision of a belief set kept as cubes
+//The cubes only get expanded into every completion if the preorder, engine, or update mode needs full states
+std::vector<std::vector<int32_t>> revise_beliefs(const packed_states& belief_cubes,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings, const char* output_file,
+        const revision_options& options) noexcept {
+    if (!works_on_cubes(orderings, options)) {
+        std::vector<std::vector<int32_t>> terms;
+        terms.reserve(belief_cubes.size);
+        for (unsigned long i = 0; i < belief_cubes.size; ++i) {
+            terms.emplace_back(unpack_cube(belief_cubes, i));
+        }
+        auto original_beliefs = convert_dnf_to_raw(terms);
+        return revise_beliefs(original_beliefs, formula, orderings, output_file, options);
+    }
+
+    const auto completed = (options.op == revision_operator::DALAL)
+            ? cube_revision(belief_cubes, formula_cubes(formula, belief_cubes.state_length))
+            : operator_revision(options.op, formula_cubes(formula, belief_cubes.state_length),
+                      belief_cubes);
+
+    std::vector<std::vector<int32_t>> revised_terms;
+    revised_terms.reserve(completed.size);
+    for (unsigned long i = 0; i < completed.size; ++i) {
+        revised_terms.emplace_back(unpack_cube(completed, i));
+    }
+    std::sort(revised_terms.begin(), revised_terms.end());
+    revised_terms.erase(
+            std::unique(revised_terms.begin(), revised_terms.end()), revised_terms.end());
+
+    return report_terms(revised_terms, output_file);
+}
+
+//Iterated revision, where every step replaces the packed belief set with its revision by the next formula
+//Belief cubes stay packed across steps when the options allow it, and are otherwise expanded for each step
+std::vector<std::vector<int32_t>> iterate_revision(packed_states& beliefs,
+        const std::vector<std::vector<std::vector<int32_t>>>& formulas,
+        const std::unordered_map<int32_t, unsigned long> orderings, const char* output_file,
+        const revision_options& options) noexcept {
+    const bool on_cubes = works_on_cubes(orderings, options);
+
+    const double start_time = omp_get_wtime();
+
+    for (unsigned long step = 0; step < formulas.size(); ++step) {
+        const auto& formula = formulas[step];
+
+        const double step_time = omp_get_wtime();
+
+        if (on_cubes) {
+            const auto cube_bits = formula_cubes(formula, beliefs.state_length);
+            beliefs = unique_rows((options.op == revision_operator::DALAL)
+                            ? cube_revision(beliefs, cube_bits)
+                            : operator_revision(options.op, cube_bits, beliefs));
+        } else {
+            check_formula_variables(formula, beliefs.state_length);
+
+            auto original_beliefs = expand_cubes(beliefs);
+            std::sort(original_beliefs.begin(), original_beliefs.end());
+            original_beliefs.erase(std::unique(original_beliefs.begin(), original_beliefs.end()),
+                    original_beliefs.end());
+
+            beliefs = unique_rows(
+                    pack_states(revise_states(original_beliefs, formula, orderings, options)));
+        }
+
+        report_stream() << "Step " << (step + 1) << " of " << formulas.size() << ": " << beliefs.size
+                  << " beliefs in " << (omp_get_wtime() - step_time) * 1000.0 << " ms\n";
+    }
+
+    report_stream() << "Total revision time: " << (omp_get_wtime() - start_time) * 1000.0 << " ms\n";
+
+    return report_packed(beliefs, output_file);
+}
+
+//Every worker runs the inner kernels with its share of the threads, and unknown custom pre-orders get a single worker
+//since they may not be safe to call from several threads at once
+void batch_revision(const packed_states& beliefs,
+        const std::vector<std::vector<std::vector<int32_t>>>& formulas,
+        const std::vector<std::string>& output_files,
+        const std::unordered_map<int32_t, unsigned long> orderings, const revision_options& options,
+        const unsigned long jobs) noexcept {
+    assert(formulas.size() == output_files.size());
+
+    const bool on_cubes = works_on_cubes(orderings, options);
+
+    //Workers that need full states all share the one expanded copy
+    std::vector<std::vector<bool>> original_beliefs;
+    if (!on_cubes) {
+        original_beliefs = expand_cubes(beliefs);
+        std::sort(original_beliefs.begin(), original_beliefs.end());
+        original_beliefs.erase(std::unique(original_beliefs.begin(), original_beliefs.end()),
+                original_beliefs.end());
+    }
+
+    const unsigned long thread_count = omp_get_max_threads();
+    unsigned long worker_count = 1;
+    if (active_preorder() != preorder_kind::CUSTOM) {
+        worker_count = std::min((jobs) ? jobs : thread_count, formulas.size());
+    }
+    const int kernel_threads = std::max(1ul, thread_count / worker_count);
+
+    report_stream() << "Revising " << formulas.size() << " formulas with " << worker_count << " workers of "
+              << kernel_threads << " threads\n";
+
+    const int old_levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+
+    const double start_time = omp_get_wtime();
+
+    //Each worker reports into its formula's own buffer, and the buffers are printed in order at the end
+    std::vector<std::string> reports(formulas.size());
+
+#pragma omp parallel for num_threads(worker_count) schedule(dynamic, 1)
+    for (unsigned long i = 0; i < formulas.size(); ++i) {
+        omp_set_num_threads(kernel_threads);
+
+        std::ostringstream report;
+        redirect_reports(&report);
+
+        const auto& formula = formulas[i];
+        const char* output_file = output_files[i].c_str();
+
+        const double formula_time = omp_get_wtime();
+
+        if (on_cubes) {
+            const auto cube_bits = formula_cubes(formula, beliefs.state_length);
+            report_packed(unique_rows((options.op == revision_operator::DALAL)
+                                          ? cube_revision(beliefs, cube_bits)
+                                          : operator_revision(options.op, cube_bits, beliefs)),
+                    output_file);
+        } else {
+            check_formula_variables(formula, beliefs.state_length);
+            report_revision(revise_states(original_beliefs, formula, orderings, options), output_file);
+        }
+
+        report << "Formula " << (i + 1) << " of " << formulas.size() << " written to " << output_file
+               << " in " << (omp_get_wtime() - formula_time) * 1000.0 << " ms\n";
+
+        redirect_reports(nullptr);
+        reports[i] = report.str();
+    }
+
+    omp_set_max_active_levels(old_levels);
+
+    for (const auto& report : reports) {
+        report_stream() << report;
+    }
+
+    report_stream() << "Total batch time: " << (omp_get_wtime() - start_time) * 1000.0 << " ms\n";
+}
+
+//Merging scores every formula state against each source in a single pass, then aggregates the distances
+//Every formula state is enumerated, since the sources can disagree on the variables the formula leaves free
+std::vector<std::vector<int32_t>> merge_beliefs(
+        const std::vector<std::vector<std::vector<bool>>>& sources,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings, const char* output_file,
+        const merge_aggregate aggregate) noexcept {
+    const auto belief_length = sources.front().front().size();
+    const unsigned long source_count = sources.size();
+
+    auto formula_states = generate_states(formula, belief_length);
+    if (formula_states.empty()) {
+        std::cerr << "Formula is unsatisfiable\n";
+        exit(EXIT_FAILURE);
+    }
+
+    report_stream() << "Generated state size: " << formula_states.size() << "\n";
+
+    if (!std::is_sorted(formula_states.begin(), formula_states.end())) {
+        std::sort(formula_states.begin(), formula_states.end());
+    }
+
+    std::vector<unsigned long> distances;
+    if (active_preorder() == preorder_kind::HAMMING) {
+        std::vector<std::vector<bool>> all_beliefs;
+        std::vector<unsigned long> source_begin;
+        for (const auto& source : sources) {
+            source_begin.push_back(all_beliefs.size());
+            all_beliefs.insert(all_beliefs.end(), source.cbegin(), source.cend());
+        }
+
+        const auto formula_bits = pack_states(formula_states);
+        const auto belief_bits = pack_states(all_beliefs);
+
+        if (orderings.empty()) {
+            distances = source_min_distances(formula_bits, belief_bits, source_begin);
+        } else {
+            const auto tiers = compile_tiers(orderings, belief_length);
+            distances = source_min_distances(formula_bits, belief_bits, source_begin, &tiers);
+        }
+    } else {
+        //One pass per source, scattered into the same row-major layout as the packed scan
+        distances.resize(formula_states.size() * source_count);
+        for (unsigned long k = 0; k < source_count; ++k) {
+            const auto source_distances = preorder_distances(formula_states, sources[k]);
+            for (unsigned long i = 0; i < formula_states.size(); ++i) {
+                distances[i * source_count + k] = source_distances[i];
+            }
+        }
+    }
+
+    std::vector<unsigned long> winners;
+    if (aggregate == merge_aggregate::GMAX) {
+        //Each state's distances sorted from largest to smallest, compared lexicographically
+        std::vector<std::vector<unsigned long>> keys(formula_states.size());
+        for (unsigned long i = 0; i < formula_states.size(); ++i) {
+            keys[i].assign(distances.cbegin() + i * source_count,
+                    distances.cbegin() + (i + 1) * source_count);
+            std::sort(keys[i].begin(), keys[i].end(), std::greater<unsigned long>());
+        }
+        const auto& best = *std::min_element(keys.cbegin(), keys.cend());
+        for (unsigned long i = 0; i < formula_states.size(); ++i) {
+            if (keys[i] == best) {
+                winners.push_back(i);
+            }
+        }
+    } else {
+        min_collector collector;
+        for (unsigned long i = 0; i < formula_states.size(); ++i) {
+            const auto first = distances.cbegin() + i * source_count;
+            const auto last = first + source_count;
+            collector.add((aggregate == merge_aggregate::SUM)
+                            ? std::accumulate(first, last, 0ul)
+                            : *std::max_element(first, last),
+                    i);
+        }
+        report_stream() << collector.best << "\n";
+        winners = std::move(collector.indices);
+    }
+
+    std::vector<std::vector<bool>> merged_beliefs;
+    merged_beliefs.reserve(winners.size());
+    for (const auto i : winners) {
+        merged_beliefs.push_back(formula_states[i]);
+    }
+
+    return report_revision(merged_beliefs, output_file);
+}
+
+//Contraction by the Harper identity, keeping the beliefs and adding the closest states that falsify the formula
+//The negated formula's cubes come from complementing the solver's cubes for the formula itself
+std::vector<std::vector<int32_t>> contract_beliefs(std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings, const char* output_file) noexcept {
+    const auto belief_length = original_beliefs.front().size();
+    check_formula_variables(formula, belief_length);
+
+    std::sort(original_beliefs.begin(), original_beliefs.end());
+    original_beliefs.erase(
+            std::unique(original_beliefs.begin(), original_beliefs.end()), original_beliefs.end());
+
+    //An unsatisfiable formula is fine here, since its negation then covers every state
+    const auto formula_bits = pack_cubes(run_allsat(formula), belief_length);
+
+    report_stream() << "Generated cube count: " << formula_bits.size << "\n";
+
+    const auto negated_bits = complement_cubes(formula_bits);
+
+    report_stream() << "Negated cube count: " << negated_bits.size << "\n";
+
+    std::vector<std::vector<bool>> contracted_beliefs = original_beliefs;
+
+    //A tautology can't be given up, so the beliefs are left as they are
+    if (negated_bits.size != 0) {
+        std::vector<std::vector<bool>> revised_beliefs;
+
+        if (active_preorder() == preorder_kind::HAMMING && orderings.empty()) {
+            const auto completed = cube_revision(pack_states(original_beliefs), negated_bits);
+            for (unsigned long i = 0; i < completed.size; ++i) {
+                revised_beliefs.emplace_back(unpack_state(completed, i));
+            }
+        } else {
+            auto negated_states = expand_cubes(negated_bits);
+            std::sort(negated_states.begin(), negated_states.end());
+
+            report_stream() << "Generated state size: " << negated_states.size() << "\n";
+
+            std::set_intersection(negated_states.cbegin(), negated_states.cend(),
+                    original_beliefs.cbegin(), original_beliefs.cend(),
+                    std::back_inserter(revised_beliefs));
+
+            if (revised_beliefs.empty()) {
+                min_collector collector;
+                if (active_preorder() == preorder_kind::HAMMING) {
+                    const auto tiers = compile_tiers(orderings, belief_length);
+                    collector = collect_min_distances(
+                            pack_states(negated_states), pack_states(original_beliefs), 0, &tiers);
+                } else {
+                    collector = collect_minimum(
+                            preorder_distances(negated_states, original_beliefs));
+                }
+
+                report_stream() << collector.best << "\n";
+
+                for (const auto i : collector.indices) {
+                    revised_beliefs.push_back(negated_states[i]);
+                }
+            }
+        }
+
+        contracted_beliefs.insert(
+                contracted_beliefs.end(), revised_beliefs.cbegin(), revised_beliefs.cend());
+        std::sort(contracted_beliefs.begin(), contracted_beliefs.end());
+        contracted_beliefs.erase(std::unique(contracted_beliefs.begin(), contracted_beliefs.end()),
+                contracted_beliefs.end());
+    }
+
+    return report_revision(contracted_beliefs, output_file);
+}
+
 std::vector<std::vector<int32_t>> minimize_output(
         const std::vector<std::vector<int32_t>>& original_terms) noexcept {
     std::vector<std::vector<int32_t>> output;
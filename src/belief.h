@@ -1,24 +1,26 @@
 #ifndef BELIEF_H
 #define BELIEF_H
 
-#include <bitset>
 #include <functional>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
-template<typename T, typename... U>
-constexpr auto get_function_address(const std::function<T(U...)>& f) {
-    return *f.template target<T (*)(U...)>();
-}
-
-template<typename T, typename... U>
-constexpr auto operator==(const std::function<T(U...)>& lhs, const std::function<T(U...)>& rhs) {
-    return get_function_address(lhs) == get_function_address(rhs);
-}
+#include "packed.h"
 
 extern std::function<unsigned long(const std::vector<bool>&, const std::vector<std::vector<bool>>&)>
         total_preorder;
 
+//Runs the All-SAT solver on a CNF clause list and returns the cubes it outputs
+//Exits with an error if the solver fails, rather than mistaking its missing output for no models
+std::vector<std::vector<int32_t>> run_allsat(
+        const std::vector<std::vector<int32_t>>& clause_list) noexcept;
+
+//Same as run_allsat, but returns false instead of exiting if the solver did not run to completion
+//No models are only reported once the solver has actually proven the clause list unsatisfiable
+bool try_run_allsat(const std::vector<std::vector<int32_t>>& clause_list,
+        std::vector<std::vector<int32_t>>& cubes) noexcept;
+
 //Generates a vector of all possible states given a formula clause list and the total belief length
 std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int32_t>>& clause_list,
         const unsigned long belief_length) noexcept;
@@ -27,18 +29,101 @@ std::vector<std::vector<bool>> generate_states(const std::vector<std::vector<int
 //Currently uses Hamming weight
 unsigned long state_difference(
         const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set);
-unsigned long hamming(
-        const std::bitset<512>& state, const std::vector<std::bitset<512>>& belief_set) noexcept;
+//Example custom pre-order that ranks states by their first three variables, ignoring the beliefs
+unsigned long example_preorder(
+        const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set);
+
+//Strategies revise_beliefs can use to find the closest formula states
+enum class revision_engine {
+    //Pick based on the size of the formula and the belief set
+    AUTO,
+    //Enumerate every formula model with the All-SAT solver, then score each one
+    ENUMERATE,
+    //Search outward from the beliefs one Hamming radius at a time
+    RADIUS,
+    //Find the optimal distance with cardinality constrained SAT calls, then enumerate only that layer
+    SAT
+};
 
-unsigned long pd_hamming(const std::vector<bool>& state,
-        const std::vector<std::vector<bool>>& belief_set,
-        const std::unordered_map<int32_t, unsigned long>& orderings);
-unsigned long pd_hamming_bitset(const std::bitset<512>& state,
-        const std::vector<std::bitset<512>>& belief_set,
-        const std::unordered_map<int32_t, unsigned long>& orderings) noexcept;
+//Operators revise_beliefs can apply
+enum class revision_operator {
+    //Keep the formula states at the minimum distance from the beliefs
+    DALAL,
+    //Keep the formula states whose symmetric difference from some belief is set-inclusion minimal
+    SATOH,
+    //Keep the formula states that agree with some belief outside the variables in any minimal difference
+    WEBER
+};
+
+//Settings that control how revise_beliefs computes its result
+struct revision_options {
+    revision_engine engine = revision_engine::AUTO;
+    //Index the belief set with multi-index hashing instead of scanning it linearly
+    bool use_mih_index = false;
+    //Transpose the belief set into bit-planes and score blocks of beliefs at once with bit-sliced counters
+    bool use_vertical_layout = false;
+    //Number of pivot beliefs used to prune the scan with the triangle inequality, where 0 turns pruning off
+    unsigned long pivot_count = 0;
+    //Number of distance layers to output, starting from the closest
+    //More than one layer always enumerates every formula state, whatever engine was requested
+    unsigned long layers = 1;
+    //Operator to revise with, where anything other than Dalal ignores the pre-order, orderings and engine
+    revision_operator op = revision_operator::DALAL;
+    //Update instead of revising, keeping the closest formula states to each belief rather than to the whole set
+    //This always enumerates, so the engine is ignored
+    bool update = false;
+};
 
 //The main revision function
 std::vector<std::vector<int32_t>> revise_beliefs(std::vector<std::vector<bool>>& original_beliefs,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings = {},
+        const char* output_file = nullptr, const revision_options& options = {}) noexcept;
+
+//Revision of a belief set given as cubes, which are only expanded when the preorder, engine, or update mode needs it
+std::vector<std::vector<int32_t>> revise_beliefs(const packed_states& belief_cubes,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings = {},
+        const char* output_file = nullptr, const revision_options& options = {}) noexcept;
+
+//Revises the belief set by each formula in order, replacing the packed beliefs in place after every step
+//The beliefs can be full states or cubes, and every formula must be in CNF format
+std::vector<std::vector<int32_t>> iterate_revision(packed_states& beliefs,
+        const std::vector<std::vector<std::vector<int32_t>>>& formulas,
+        const std::unordered_map<int32_t, unsigned long> orderings = {},
+        const char* output_file = nullptr, const revision_options& options = {}) noexcept;
+
+//Revises the same belief set by every formula, writing each result to the matching output file
+//The beliefs are prepared once and shared by a pool of workers, each revising one formula at a time
+//A job count of zero uses one worker per available thread
+void batch_revision(const packed_states& beliefs,
+        const std::vector<std::vector<std::vector<int32_t>>>& formulas,
+        const std::vector<std::string>& output_files,
+        const std::unordered_map<int32_t, unsigned long> orderings = {},
+        const revision_options& options = {}, const unsigned long jobs = 0) noexcept;
+
+//How merge_beliefs combines the distances from each belief source
+enum class merge_aggregate {
+    //Sum of the distances
+    SUM,
+    //Largest distance
+    MAX,
+    //Distances sorted from largest to smallest, compared lexicographically
+    GMAX
+};
+
+//Merges several belief sources under the formula as an integrity constraint
+//Every source must contain equal length bit assignments, and the formula must be in CNF format
+std::vector<std::vector<int32_t>> merge_beliefs(
+        const std::vector<std::vector<std::vector<bool>>>& sources,
+        const std::vector<std::vector<int32_t>>& formula,
+        const std::unordered_map<int32_t, unsigned long> orderings = {},
+        const char* output_file = nullptr,
+        const merge_aggregate aggregate = merge_aggregate::SUM) noexcept;
+
+//Contracts the belief set by the formula, so the result no longer entails it
+//Uses the Harper identity, taking the union of the beliefs and their revision by the formula's negation
+std::vector<std::vector<int32_t>> contract_beliefs(std::vector<std::vector<bool>>& original_beliefs,
         const std::vector<std::vector<int32_t>>& formula,
         const std::unordered_map<int32_t, unsigned long> orderings = {},
         const char* output_file = nullptr) noexcept;
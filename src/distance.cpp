@@ -0,0 +1,658 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <omp.h>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+
+//Number of formula states that are compared against a belief tile before moving to the next tile
+static constexpr unsigned long formula_tile_size = 64;
+
+//Size in bytes of a belief tile, chosen so the tile stays in L1 while the formula tile is swept across it
+static constexpr unsigned long belief_tile_bytes = 16384;
+
+//Number of masks past which the dense weight kernel does less work than the per-mask popcounts
+static constexpr unsigned long dense_tier_limit = 16;
+
+//Runs the kernel with the row width fixed at compile time for the common state widths, so the per-word loops
+//unroll completely, and with a width of 0 meaning the runtime word count for everything else
+template<typename Kernel>
+static inline void dispatch_width(const unsigned long word_count, Kernel&& kernel) {
+    switch (word_count) {
+        case 1:
+            kernel(std::integral_constant<unsigned long, 1>{});
+            break;
+        case 2:
+            kernel(std::integral_constant<unsigned long, 2>{});
+            break;
+        case 4:
+            kernel(std::integral_constant<unsigned long, 4>{});
+            break;
+        default:
+            kernel(std::integral_constant<unsigned long, 0>{});
+            break;
+    }
+}
+
+//Distance between a formula row and belief j, picked at compile time by what each side holds and the row width
+//Any result above bound is only known to be above it
+template<bool formula_cubes, bool belief_cubes, bool weighted, unsigned long width>
+static inline unsigned long pair_distance(const uint64_t* state, const uint64_t* care,
+        const packed_states& beliefs, const unsigned long j, const tier_masks* tiers,
+        const unsigned long bound) noexcept {
+    const unsigned long word_count = (width) ? width : beliefs.word_count;
+
+    if constexpr (weighted) {
+        return bounded_tier_distance(state, beliefs.row(j), *tiers, bound);
+    } else if constexpr (formula_cubes && belief_cubes) {
+        return bounded_cube_distance(
+                state, beliefs.row(j), care, beliefs.care_row(j), word_count, bound);
+    } else if constexpr (formula_cubes) {
+        return bounded_masked_distance(state, beliefs.row(j), care, word_count, bound);
+    } else if constexpr (belief_cubes) {
+        return bounded_masked_distance(
+                state, beliefs.row(j), beliefs.care_row(j), word_count, bound);
+    } else {
+        return bounded_distance(state, beliefs.row(j), word_count, bound);
+    }
+}
+
+//Number of beliefs in a tile, for rows of the given width
+static constexpr unsigned long belief_tile_rows(const unsigned long word_count) noexcept {
+    return std::max(1ul, belief_tile_bytes / (word_count * sizeof(uint64_t)));
+}
+
+//Consensus masks over the whole belief set, and over each belief tile
+struct tile_consensus {
+    belief_consensus whole;
+    belief_consensus tiles;
+};
+
+//Sweeps a tile of formula states across the whole belief set, one belief tile at a time
+//A row stops scanning once its running minimum reaches the lower bound
+//A pair is abandoned once its partial distance can no longer improve the row, or exceeds the shared bound
+//Rows that end above the shared bound are left with a value greater than it
+//With consensus masks, a row never goes below its distance to the agreed variables, so it stops there instead,
+//is dropped outright once that exceeds the shared bound, and skips any belief tile whose own bound is too high
+template<bool formula_cubes, bool belief_cubes, bool weighted, unsigned long width>
+static void sweep_tile(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long formula_begin, const unsigned long formula_end,
+        unsigned long* row_min, const unsigned long lower_bound,
+        std::atomic<unsigned long>* shared_bound, const tier_masks* tiers,
+        const tile_consensus* consensus) noexcept {
+    const unsigned long word_count = formula.word_count;
+    const unsigned long belief_tile_size = belief_tile_rows(word_count);
+
+    unsigned long row_floor[formula_tile_size];
+    for (unsigned long i = formula_begin; i < formula_end; ++i) {
+        const uint64_t* care = (formula_cubes) ? formula.care_row(i) : nullptr;
+        row_floor[i - formula_begin] = (consensus && consensus->whole.any_agreement)
+                ? std::max(lower_bound, consensus_distance(consensus->whole, 0, formula.row(i), care))
+                : lower_bound;
+    }
+    const bool tile_filter = consensus && consensus->tiles.any_agreement;
+
+    for (unsigned long belief_begin = 0; belief_begin < beliefs.size;
+            belief_begin += belief_tile_size) {
+        const unsigned long belief_end = std::min(belief_begin + belief_tile_size, beliefs.size);
+        const unsigned long bound
+                = (shared_bound) ? shared_bound->load(std::memory_order_relaxed) : ULONG_MAX;
+
+        bool rows_remaining = false;
+        unsigned long tile_best = ULONG_MAX;
+
+        for (unsigned long i = formula_begin; i < formula_end; ++i) {
+            unsigned long min_dist = row_min[i - formula_begin];
+            const unsigned long floor = row_floor[i - formula_begin];
+            if (min_dist <= floor) {
+                continue;
+            }
+            //The bound only ever drops, so a row that can't reach it now never will
+            if (floor > bound) {
+                continue;
+            }
+            const uint64_t* state = formula.row(i);
+            const uint64_t* care = (formula_cubes) ? formula.care_row(i) : nullptr;
+
+            if (tile_filter
+                    && consensus_distance(consensus->tiles, belief_begin / belief_tile_size, state,
+                               care)
+                            > std::min(min_dist - 1, bound)) {
+                rows_remaining = true;
+                continue;
+            }
+
+            for (unsigned long j = belief_begin; j < belief_end; ++j) {
+                const unsigned long cap = std::min(min_dist - 1, bound);
+
+                const unsigned long dist
+                        = pair_distance<formula_cubes, belief_cubes, weighted, width>(
+                                state, care, beliefs, j, tiers, cap);
+                if (dist <= cap) {
+                    min_dist = dist;
+                    if (min_dist <= floor) {
+                        break;
+                    }
+                }
+            }
+            row_min[i - formula_begin] = min_dist;
+            tile_best = std::min(tile_best, min_dist);
+            rows_remaining |= (min_dist > floor);
+        }
+
+        //Any row's running minimum is an upper bound on the global optimum
+        if (shared_bound) {
+            lower_shared_bound(*shared_bound, tile_best);
+        }
+        if (!rows_remaining) {
+            break;
+        }
+    }
+}
+
+//Picks the sweep_tile specialisation matching whether either side holds cubes, whether the distance is
+//weighted, and the row width
+static void sweep_tile(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long formula_begin, const unsigned long formula_end,
+        unsigned long* row_min, const unsigned long lower_bound,
+        std::atomic<unsigned long>* shared_bound, const tier_masks* tiers = nullptr,
+        const tile_consensus* consensus = nullptr) noexcept {
+    dispatch_width(formula.word_count, [&](auto width_constant) {
+        constexpr unsigned long width = decltype(width_constant)::value;
+
+        if (tiers) {
+            assert(!formula.is_cubes() && !beliefs.is_cubes());
+            sweep_tile<false, false, true, width>(formula, beliefs, formula_begin, formula_end,
+                    row_min, lower_bound, shared_bound, tiers, nullptr);
+        } else if (formula.is_cubes() && beliefs.is_cubes()) {
+            sweep_tile<true, true, false, width>(formula, beliefs, formula_begin, formula_end,
+                    row_min, lower_bound, shared_bound, nullptr, consensus);
+        } else if (formula.is_cubes()) {
+            sweep_tile<true, false, false, width>(formula, beliefs, formula_begin, formula_end,
+                    row_min, lower_bound, shared_bound, nullptr, consensus);
+        } else if (beliefs.is_cubes()) {
+            sweep_tile<false, true, false, width>(formula, beliefs, formula_begin, formula_end,
+                    row_min, lower_bound, shared_bound, nullptr, consensus);
+        } else {
+            sweep_tile<false, false, false, width>(formula, beliefs, formula_begin, formula_end,
+                    row_min, lower_bound, shared_bound, nullptr, consensus);
+        }
+    });
+}
+
+//Update counterpart of sweep_tile, which finds every formula row closest to each belief in a tile
+//The formula is walked one tile at a time, so each block of formula rows is reused by every belief in the tile
+//Ties are kept, so a pair is only abandoned once it exceeds the belief's current best
+template<bool formula_cubes, bool belief_cubes, bool weighted, unsigned long width>
+static void nearest_tile(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long belief_begin, const unsigned long belief_end, min_collector* nearest,
+        const tier_masks* tiers) noexcept {
+    const unsigned long formula_tile
+            = std::max(1ul, belief_tile_bytes / (formula.word_count * sizeof(uint64_t)));
+
+    for (unsigned long formula_begin = 0; formula_begin < formula.size;
+            formula_begin += formula_tile) {
+        const unsigned long formula_end = std::min(formula_begin + formula_tile, formula.size);
+
+        for (unsigned long j = belief_begin; j < belief_end; ++j) {
+            min_collector& collector = nearest[j - belief_begin];
+
+            for (unsigned long i = formula_begin; i < formula_end; ++i) {
+                const uint64_t* care = (formula_cubes) ? formula.care_row(i) : nullptr;
+                const unsigned long dist
+                        = pair_distance<formula_cubes, belief_cubes, weighted, width>(
+                                formula.row(i), care, beliefs, j, tiers, collector.best);
+                collector.add(dist, i);
+            }
+        }
+    }
+}
+
+//Picks the nearest_tile specialisation, the same way sweep_tile does
+static void nearest_tile(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long belief_begin, const unsigned long belief_end, min_collector* nearest,
+        const tier_masks* tiers) noexcept {
+    dispatch_width(formula.word_count, [&](auto width_constant) {
+        constexpr unsigned long width = decltype(width_constant)::value;
+
+        if (tiers) {
+            assert(!formula.is_cubes());
+            nearest_tile<false, false, true, width>(
+                    formula, beliefs, belief_begin, belief_end, nearest, tiers);
+        } else if (formula.is_cubes()) {
+            nearest_tile<true, false, false, width>(
+                    formula, beliefs, belief_begin, belief_end, nearest, nullptr);
+        } else {
+            nearest_tile<false, false, false, width>(
+                    formula, beliefs, belief_begin, belief_end, nearest, nullptr);
+        }
+    });
+}
+
+//Hashes a packed row
+struct packed_row_hash {
+    std::size_t operator()(const std::vector<uint64_t>& row) const noexcept {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (const auto word : row) {
+            hash = (hash ^ word) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+};
+
+//Parallelism is over formula tiles, so there is a single fork/join for the whole distance matrix
+//Each thread walks the belief set one tile at a time, sweeping its formula tile across it
+std::vector<unsigned long> min_distances(const packed_states& formula,
+        const packed_states& beliefs, const unsigned long lower_bound,
+        const tier_masks* tiers) noexcept {
+    assert(formula.word_count == beliefs.word_count);
+
+    std::vector<unsigned long> distances(formula.size, ULONG_MAX);
+
+    const unsigned long formula_tile_count
+            = (formula.size + formula_tile_size - 1) / formula_tile_size;
+
+#pragma omp parallel for schedule(dynamic)
+    for (unsigned long tile = 0; tile < formula_tile_count; ++tile) {
+        const unsigned long formula_begin = tile * formula_tile_size;
+        const unsigned long formula_end = std::min(formula_begin + formula_tile_size, formula.size);
+
+        sweep_tile(formula, beliefs, formula_begin, formula_end, distances.data() + formula_begin,
+                lower_bound, nullptr, tiers);
+    }
+
+    return distances;
+}
+
+//Same tiling as min_distances, but every thread shares the best distance found so far
+//Formula states that cannot reach that optimum are abandoned part way through their scan
+min_collector collect_min_distances(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long lower_bound, const tier_masks* tiers) noexcept {
+    assert(formula.word_count == beliefs.word_count);
+
+    min_collector output;
+    std::atomic<unsigned long> shared_bound{ULONG_MAX};
+
+    const unsigned long formula_tile_count
+            = (formula.size + formula_tile_size - 1) / formula_tile_size;
+
+    //Weighted distances don't count agreed variables once each, so only plain scans get the prefilter
+    tile_consensus consensus;
+    if (!tiers) {
+        consensus.whole = build_consensus(beliefs, beliefs.size);
+        consensus.tiles = build_consensus(beliefs, belief_tile_rows(beliefs.word_count));
+    }
+
+#pragma omp parallel
+    {
+        min_collector local;
+        unsigned long row_min[formula_tile_size];
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long tile = 0; tile < formula_tile_count; ++tile) {
+            const unsigned long formula_begin = tile * formula_tile_size;
+            const unsigned long formula_end
+                    = std::min(formula_begin + formula_tile_size, formula.size);
+
+            std::fill(std::begin(row_min), std::end(row_min), ULONG_MAX);
+
+            sweep_tile(formula, beliefs, formula_begin, formula_end, row_min, lower_bound,
+                    &shared_bound, tiers, (tiers) ? nullptr : &consensus);
+
+            for (unsigned long i = formula_begin; i < formula_end; ++i) {
+                local.add(row_min[i - formula_begin], i);
+            }
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    return output;
+}
+
+belief_consensus build_consensus(const packed_states& beliefs, const unsigned long group_size) noexcept {
+    belief_consensus consensus;
+    consensus.word_count = beliefs.word_count;
+    consensus.group_size = std::max(1ul, group_size);
+    consensus.group_count = (beliefs.size + consensus.group_size - 1) / consensus.group_size;
+    consensus.agree.assign(consensus.group_count * consensus.word_count, 0);
+    consensus.value.assign(consensus.group_count * consensus.word_count, 0);
+
+    const unsigned long state_length = beliefs.state_length;
+    const bool cubes = beliefs.is_cubes();
+    unsigned long agreement = 0;
+
+#pragma omp parallel for schedule(static) reduction(| : agreement)
+    for (unsigned long group = 0; group < consensus.group_count; ++group) {
+        const unsigned long first = group * consensus.group_size;
+        const unsigned long last = std::min(first + consensus.group_size, beliefs.size);
+
+        uint64_t* agree = consensus.agree.data() + group * consensus.word_count;
+        uint64_t* value = consensus.value.data() + group * consensus.word_count;
+
+        for (unsigned long w = 0; w < consensus.word_count; ++w) {
+            uint64_t all_set = ~0ull;
+            uint64_t any_set = 0;
+            for (unsigned long j = first; j < last; ++j) {
+                const uint64_t word = beliefs.row(j)[w];
+                all_set &= word;
+                any_set |= (cubes) ? word | ~beliefs.care_row(j)[w] : word;
+            }
+
+            //Padding bits are clear in every row, and are left out so they never look like agreement
+            const uint64_t padding = (w + 1 < consensus.word_count || state_length % 64 == 0)
+                    ? ~0ull
+                    : (1ull << (state_length % 64)) - 1;
+
+            agree[w] = (all_set | ~any_set) & padding;
+            value[w] = all_set & padding;
+            agreement |= agree[w];
+        }
+    }
+
+    consensus.any_agreement = (agreement != 0);
+
+    return consensus;
+}
+
+std::vector<unsigned long> dense_weights(const std::unordered_map<int32_t, unsigned long>& orderings,
+        const unsigned long state_length) noexcept {
+    std::vector<unsigned long> weights(state_length, 1);
+    for (unsigned long i = 0; i < state_length && i < orderings.size(); ++i) {
+        const auto it = orderings.find(i + 1);
+        if (it != orderings.end()) {
+            weights[i] = it->second;
+        }
+    }
+    return weights;
+}
+
+tier_masks compile_tiers(const std::vector<unsigned long>& weights) noexcept {
+    tier_masks tiers;
+    tiers.word_count = words_for_length(weights.size());
+
+    std::map<unsigned long, std::vector<unsigned long>, std::greater<unsigned long>> grouped;
+    unsigned long combined = 0;
+    for (unsigned long i = 0; i < weights.size(); ++i) {
+        if (weights[i]) {
+            grouped[weights[i]].push_back(i);
+        }
+        combined |= weights[i];
+    }
+
+    unsigned long plane_count = 0;
+    while (plane_count < 64 && (combined >> plane_count)) {
+        ++plane_count;
+    }
+
+    if (grouped.size() <= plane_count) {
+        //Group the variables by weight, heaviest first so bounded scans exceed their bound sooner
+        tiers.masks.assign(grouped.size() * tiers.word_count, 0);
+
+        unsigned long tier = 0;
+        for (const auto& [weight, variables] : grouped) {
+            tiers.weights.push_back(weight);
+            uint64_t* mask = tiers.masks.data() + tier * tiers.word_count;
+            for (const auto i : variables) {
+                mask[i / 64] |= (1ull << (i % 64));
+            }
+            ++tier;
+        }
+    } else {
+        //Split the weights into bit-planes, skipping any plane no weight uses
+        for (unsigned long k = plane_count; k-- > 0;) {
+            if (!((combined >> k) & 1)) {
+                continue;
+            }
+            std::vector<uint64_t> mask(tiers.word_count, 0);
+            for (unsigned long i = 0; i < weights.size(); ++i) {
+                if ((weights[i] >> k) & 1) {
+                    mask[i / 64] |= (1ull << (i % 64));
+                }
+            }
+            tiers.weights.push_back(1ul << k);
+            tiers.masks.insert(tiers.masks.end(), mask.cbegin(), mask.cend());
+        }
+    }
+
+    if (tiers.size() > dense_tier_limit) {
+        tiers.dense.assign(tiers.word_count, weight_block{});
+        for (unsigned long i = 0; i < weights.size(); ++i) {
+            tiers.dense[i / 64].weight[i % 64] = weights[i];
+        }
+    }
+
+    return tiers;
+}
+
+tier_masks compile_tiers(const std::unordered_map<int32_t, unsigned long>& orderings,
+        const unsigned long state_length) noexcept {
+    return compile_tiers(dense_weights(orderings, state_length));
+}
+
+packed_states complete_from_beliefs(const packed_states& cubes,
+        const std::vector<unsigned long>& winners, const packed_states& beliefs,
+        const unsigned long distance) noexcept {
+    const unsigned long word_count = cubes.word_count;
+    const bool belief_cubes = beliefs.is_cubes();
+
+    packed_states output;
+    output.state_length = cubes.state_length;
+    output.word_count = word_count;
+
+#pragma omp parallel
+    {
+        std::vector<uint64_t> local_words;
+        std::vector<uint64_t> local_care;
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long w = 0; w < winners.size(); ++w) {
+            const uint64_t* value = cubes.row(winners[w]);
+            const uint64_t* care = cubes.care_row(winners[w]);
+
+            for (unsigned long j = 0; j < beliefs.size; ++j) {
+                const uint64_t* belief = beliefs.row(j);
+
+                if (!belief_cubes) {
+                    if (bounded_masked_distance(value, belief, care, word_count, distance)
+                            != distance) {
+                        continue;
+                    }
+                    for (unsigned long k = 0; k < word_count; ++k) {
+                        local_words.push_back(value[k] | (belief[k] & ~care[k]));
+                    }
+                    continue;
+                }
+
+                //Against a belief cube, bits that neither side cares about stay free in the result
+                const uint64_t* belief_care = beliefs.care_row(j);
+                if (bounded_cube_distance(value, belief, care, belief_care, word_count, distance)
+                        != distance) {
+                    continue;
+                }
+                for (unsigned long k = 0; k < word_count; ++k) {
+                    local_words.push_back(value[k] | (belief[k] & ~care[k]));
+                    local_care.push_back(care[k] | belief_care[k]);
+                }
+            }
+        }
+
+#pragma omp critical(complete_from_beliefs)
+        {
+            output.words.insert(output.words.end(), local_words.cbegin(), local_words.cend());
+            output.care.insert(output.care.end(), local_care.cbegin(), local_care.cend());
+        }
+    }
+
+    output.size = output.words.size() / std::max(1ul, word_count);
+
+    return output;
+}
+
+min_collector collect_minimum(const std::vector<unsigned long>& distances) {
+    min_collector output;
+
+#pragma omp parallel
+    {
+        min_collector local;
+
+#pragma omp for schedule(static) nowait
+        for (unsigned long i = 0; i < distances.size(); ++i) {
+            local.add(distances[i], i);
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    return output;
+}
+
+layer_collector collect_layers(
+        const std::vector<unsigned long>& distances, const unsigned long layer_count) {
+    layer_collector output;
+    output.layer_count = layer_count;
+
+#pragma omp parallel
+    {
+        layer_collector local;
+        local.layer_count = layer_count;
+
+#pragma omp for schedule(static) nowait
+        for (unsigned long i = 0; i < distances.size(); ++i) {
+            local.add(distances[i], i);
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    return output;
+}
+
+packed_states pointwise_update(const packed_states& formula, const packed_states& beliefs,
+        const tier_masks* tiers) noexcept {
+    assert(formula.word_count == beliefs.word_count);
+    assert(!beliefs.is_cubes());
+
+    const unsigned long word_count = formula.word_count;
+    const unsigned long belief_tile_count
+            = (beliefs.size + formula_tile_size - 1) / formula_tile_size;
+
+    std::unordered_set<std::vector<uint64_t>, packed_row_hash> unique_rows;
+
+#pragma omp parallel
+    {
+        std::unordered_set<std::vector<uint64_t>, packed_row_hash> local_rows;
+        min_collector nearest[formula_tile_size];
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long tile = 0; tile < belief_tile_count; ++tile) {
+            const unsigned long belief_begin = tile * formula_tile_size;
+            const unsigned long belief_end
+                    = std::min(belief_begin + formula_tile_size, beliefs.size);
+
+            std::fill(std::begin(nearest), std::end(nearest), min_collector{});
+
+            nearest_tile(formula, beliefs, belief_begin, belief_end, nearest, tiers);
+
+            //Each winning cube copies its don't care bits from the belief it is closest to
+            for (unsigned long j = belief_begin; j < belief_end; ++j) {
+                const uint64_t* belief = beliefs.row(j);
+
+                for (const auto i : nearest[j - belief_begin].indices) {
+                    const uint64_t* value = formula.row(i);
+
+                    std::vector<uint64_t> row(value, value + word_count);
+                    if (formula.is_cubes()) {
+                        for (unsigned long k = 0; k < word_count; ++k) {
+                            row[k] |= belief[k] & ~formula.care_row(i)[k];
+                        }
+                    }
+                    local_rows.insert(std::move(row));
+                }
+            }
+        }
+
+#pragma omp critical(pointwise_update)
+        unique_rows.merge(local_rows);
+    }
+
+    packed_states output;
+    output.state_length = formula.state_length;
+    output.word_count = word_count;
+    output.size = unique_rows.size();
+    output.words.reserve(output.size * word_count);
+    for (const auto& row : unique_rows) {
+        output.words.insert(output.words.end(), row.cbegin(), row.cend());
+    }
+
+    return output;
+}
+
+std::vector<unsigned long> source_min_distances(const packed_states& formula,
+        const packed_states& beliefs, const std::vector<unsigned long>& source_begin,
+        const tier_masks* tiers) noexcept {
+    assert(formula.word_count == beliefs.word_count);
+    assert(!formula.is_cubes() && !beliefs.is_cubes());
+
+    const unsigned long word_count = formula.word_count;
+    const unsigned long source_count = source_begin.size();
+    const unsigned long belief_tile_size
+            = std::max(1ul, belief_tile_bytes / (word_count * sizeof(uint64_t)));
+    const unsigned long formula_tile_count
+            = (formula.size + formula_tile_size - 1) / formula_tile_size;
+
+    std::vector<unsigned long> distances(formula.size * source_count, ULONG_MAX);
+
+#pragma omp parallel for schedule(dynamic)
+    for (unsigned long tile = 0; tile < formula_tile_count; ++tile) {
+        const unsigned long formula_begin = tile * formula_tile_size;
+        const unsigned long formula_end = std::min(formula_begin + formula_tile_size, formula.size);
+
+        for (unsigned long belief_begin = 0; belief_begin < beliefs.size;
+                belief_begin += belief_tile_size) {
+            const unsigned long belief_end
+                    = std::min(belief_begin + belief_tile_size, beliefs.size);
+
+            //Source of the first belief in the tile, which advances as the tile crosses into the next source
+            const unsigned long first_source = std::upper_bound(source_begin.cbegin(),
+                                                       source_begin.cend(), belief_begin)
+                    - source_begin.cbegin() - 1;
+
+            for (unsigned long i = formula_begin; i < formula_end; ++i) {
+                const uint64_t* state = formula.row(i);
+                unsigned long* row_min = distances.data() + i * source_count;
+
+                unsigned long source = first_source;
+                for (unsigned long j = belief_begin; j < belief_end; ++j) {
+                    while (source + 1 < source_count && j >= source_begin[source + 1]) {
+                        ++source;
+                    }
+                    const unsigned long cap = row_min[source];
+                    if (cap == 0) {
+                        continue;
+                    }
+                    const unsigned long dist = (tiers)
+                            ? bounded_tier_distance(state, beliefs.row(j), *tiers, cap - 1)
+                            : bounded_distance(state, beliefs.row(j), word_count, cap - 1);
+                    if (dist < cap) {
+                        row_min[source] = dist;
+                    }
+                }
+            }
+        }
+    }
+
+    return distances;
+}
@@ -0,0 +1,284 @@
+#ifndef DISTANCE_H
+#define DISTANCE_H
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "packed.h"
+
+//Streaming arg-min over (distance, index) pairs
+//Only the best distance seen so far and the indices that reach it are kept
+struct min_collector {
+    unsigned long best = ULONG_MAX;
+    std::vector<unsigned long> indices;
+
+    void add(const unsigned long distance, const unsigned long index) {
+        if (distance < best) {
+            best = distance;
+            indices.clear();
+        }
+        if (distance == best) {
+            indices.push_back(index);
+        }
+    }
+
+    void merge(const min_collector& other) {
+        if (other.best < best) {
+            best = other.best;
+            indices = other.indices;
+        } else if (other.best == best) {
+            indices.insert(indices.end(), other.indices.cbegin(), other.indices.cend());
+        }
+    }
+};
+
+//Streaming collector for the closest few distances, keeping every index at each of them
+//Once layer_count distances are held, anything past the furthest one is dropped without being stored
+struct layer_collector {
+    unsigned long layer_count = 1;
+    std::map<unsigned long, std::vector<unsigned long>> layers;
+
+    //The distance a new entry must not exceed to be kept
+    unsigned long bound() const {
+        return (layers.size() < layer_count) ? ULONG_MAX : layers.rbegin()->first;
+    }
+
+    void add(const unsigned long distance, const unsigned long index) {
+        if (distance > bound()) {
+            return;
+        }
+        layers[distance].push_back(index);
+        if (layers.size() > layer_count) {
+            layers.erase(std::prev(layers.end()));
+        }
+    }
+
+    void merge(const layer_collector& other) {
+        for (const auto& [distance, indices] : other.layers) {
+            if (distance > bound()) {
+                break;
+            }
+            auto& layer = layers[distance];
+            layer.insert(layer.end(), indices.cbegin(), indices.cend());
+            if (layers.size() > layer_count) {
+                layers.erase(std::prev(layers.end()));
+            }
+        }
+    }
+};
+
+//Hamming distance between two packed rows, accumulated a word at a time
+//Gives up as soon as the partial count exceeds the bound, in which case the result is only known to be above it
+inline unsigned long bounded_distance(const uint64_t* first, const uint64_t* second,
+        const unsigned long word_count, const unsigned long bound) noexcept {
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < word_count; ++i) {
+        count += __builtin_popcountll(first[i] ^ second[i]);
+        if (count > bound) {
+            break;
+        }
+    }
+    return count;
+}
+
+//Same as bounded_distance, but only counts the differing bits that are set in mask
+//With a cube's care mask this is the distance from the other row to the closest completion of the cube
+inline unsigned long bounded_masked_distance(const uint64_t* first, const uint64_t* second,
+        const uint64_t* mask, const unsigned long word_count, const unsigned long bound) noexcept {
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < word_count; ++i) {
+        count += __builtin_popcountll((first[i] ^ second[i]) & mask[i]);
+        if (count > bound) {
+            break;
+        }
+    }
+    return count;
+}
+
+//Distance between the closest completions of two cubes, which only counts bits both cubes care about
+inline unsigned long bounded_cube_distance(const uint64_t* first, const uint64_t* second,
+        const uint64_t* first_care, const uint64_t* second_care, const unsigned long word_count,
+        const unsigned long bound) noexcept {
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < word_count; ++i) {
+        count += __builtin_popcountll((first[i] ^ second[i]) & first_care[i] & second_care[i]);
+        if (count > bound) {
+            break;
+        }
+    }
+    return count;
+}
+
+//The weights of 64 consecutive variables, aligned so a whole word's weights load as full vectors
+struct alignas(64) weight_block {
+    unsigned long weight[64];
+};
+
+//Per-variable weights compiled into masks, where a distance is the sum of each mask's popcount times its weight
+//The masks are either one per distinct weight, or one per bit of the weights (bit-plane k weighs 2^k),
+//whichever needs fewer, and are stored heaviest first
+//Zero weight variables are left out since they never add to a distance
+//When even the fewer of the two needs too many masks, the dense per-variable weights are kept as well
+struct tier_masks {
+    unsigned long word_count = 0;
+    std::vector<unsigned long> weights;
+    std::vector<uint64_t> masks;
+    std::vector<weight_block> dense;
+
+    unsigned long size() const noexcept {
+        return weights.size();
+    }
+    const uint64_t* mask(const unsigned long tier) const noexcept {
+        return masks.data() + tier * word_count;
+    }
+};
+
+//Weighted distance over the dense weights, one word at a time
+//The inner loop has no branches, so it vectorises as a masked sum over the word's 64 weights
+inline unsigned long bounded_dense_distance(const uint64_t* first, const uint64_t* second,
+        const tier_masks& tiers, const unsigned long bound) noexcept {
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < tiers.word_count && count <= bound; ++i) {
+        const uint64_t diff = first[i] ^ second[i];
+        const unsigned long* weight = tiers.dense[i].weight;
+        unsigned long word_count = 0;
+#pragma omp simd reduction(+ : word_count)
+        for (unsigned long j = 0; j < 64; ++j) {
+            word_count += ((diff >> j) & 1) * weight[j];
+        }
+        count += word_count;
+    }
+    return count;
+}
+
+//Weighted distance as a sum of per-mask popcounts
+//Gives up once the partial count exceeds the bound, checking after each mask
+inline unsigned long bounded_tier_distance(const uint64_t* first, const uint64_t* second,
+        const tier_masks& tiers, const unsigned long bound) noexcept {
+    if (!tiers.dense.empty()) {
+        return bounded_dense_distance(first, second, tiers, bound);
+    }
+    unsigned long count = 0;
+    for (unsigned long t = 0; t < tiers.size() && count <= bound; ++t) {
+        const uint64_t* mask = tiers.mask(t);
+        unsigned long tier_count = 0;
+        for (unsigned long i = 0; i < tiers.word_count; ++i) {
+            tier_count += __builtin_popcountll((first[i] ^ second[i]) & mask[i]);
+        }
+        count += tier_count * tiers.weights[t];
+    }
+    return count;
+}
+
+//Lowers a bound shared between threads to value, if it is currently higher
+inline void lower_shared_bound(std::atomic<unsigned long>& bound, const unsigned long value) noexcept {
+    unsigned long current = bound.load(std::memory_order_relaxed);
+    while (value < current
+            && !bound.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+//Variables on which every belief of a group agrees, for groups of group_size consecutive beliefs
+//Built from the AND of each group's rows, marking the variables every belief sets, and their OR, marking the
+//variables any belief sets, where a cube's don't care bits could be either
+//Distance to the agreed variables alone is a lower bound on the distance to every belief in the group
+struct belief_consensus {
+    unsigned long word_count = 0;
+    unsigned long group_size = 0;
+    unsigned long group_count = 0;
+    //Whether any group agrees on any variable, since every bound is 0 otherwise
+    bool any_agreement = false;
+    std::vector<uint64_t> agree;
+    std::vector<uint64_t> value;
+
+    const uint64_t* agree_row(const unsigned long group) const noexcept {
+        return agree.data() + group * word_count;
+    }
+    const uint64_t* value_row(const unsigned long group) const noexcept {
+        return value.data() + group * word_count;
+    }
+};
+
+//Lower bound on the distance from a state to every belief of a group, counting only the agreed variables
+//A formula cube passes its care mask, so its don't care bits are never counted
+inline unsigned long consensus_distance(const belief_consensus& consensus,
+        const unsigned long group, const uint64_t* state, const uint64_t* care) noexcept {
+    const uint64_t* agree = consensus.agree_row(group);
+    const uint64_t* value = consensus.value_row(group);
+
+    unsigned long count = 0;
+    for (unsigned long i = 0; i < consensus.word_count; ++i) {
+        const uint64_t mask = (care) ? agree[i] & care[i] : agree[i];
+        count += __builtin_popcountll((state[i] ^ value[i]) & mask);
+    }
+    return count;
+}
+
+//Builds the consensus masks over every group_size consecutive beliefs
+belief_consensus build_consensus(const packed_states& beliefs, const unsigned long group_size) noexcept;
+
+//Calculates the minimum Hamming distance between every formula state and the belief set
+//Both sets are tiled so each block of beliefs is reused across many formula states while it is still in cache
+//If either side holds cubes, each distance is between the closest completions
+//A state stops scanning beliefs once it reaches lower_bound, since nothing can be closer than that
+//With tiers, distances are the weighted pd distance instead
+std::vector<unsigned long> min_distances(const packed_states& formula,
+        const packed_states& beliefs, const unsigned long lower_bound = 0,
+        const tier_masks* tiers = nullptr) noexcept;
+
+//Branch-and-bound version of min_distances that only returns the states at the global minimum
+//States whose partial distance already exceeds the best found so far are abandoned mid-scan
+//Unweighted scans first prefilter each state with the consensus of the whole belief set, so states that
+//can't reach the best found so far are never scanned, and belief tiles are skipped on their own consensus
+//With tiers, distances are the weighted pd distance instead, which only supports full states
+min_collector collect_min_distances(const packed_states& formula, const packed_states& beliefs,
+        const unsigned long lower_bound = 0, const tier_masks* tiers = nullptr) noexcept;
+
+//Expands pd orderings into one weight per variable, for state_length variables
+//Variables past the size of the orderings have a weight of 1
+std::vector<unsigned long> dense_weights(const std::unordered_map<int32_t, unsigned long>& orderings,
+        const unsigned long state_length) noexcept;
+
+//Compiles per-variable weights into tier masks
+tier_masks compile_tiers(const std::vector<unsigned long>& weights) noexcept;
+
+//Compiles pd orderings into tier masks over state_length variables
+tier_masks compile_tiers(const std::unordered_map<int32_t, unsigned long>& orderings,
+        const unsigned long state_length) noexcept;
+
+//Expands the winning formula cubes into the states at the optimal distance
+//Each cube's don't care bits are copied from every belief that sits at the optimal distance from it,
+//since any other choice for those bits would only move the state further away
+//If the beliefs are cubes as well, the result is a set of cubes that leaves free whatever neither side fixes
+packed_states complete_from_beliefs(const packed_states& cubes,
+        const std::vector<unsigned long>& winners, const packed_states& beliefs,
+        const unsigned long distance) noexcept;
+
+//Pointwise update, which keeps the formula rows closest to each belief on its own rather than to the whole set
+//Each winning cube is completed from its belief as complete_from_beliefs does, and duplicates are removed
+//The beliefs must be full states, since every model of a belief cube would need its own closest rows
+//With tiers the distances are weighted, which needs full formula states as well
+packed_states pointwise_update(const packed_states& formula, const packed_states& beliefs,
+        const tier_masks* tiers = nullptr) noexcept;
+
+//Minimum distance from every formula state to each of several belief sources, in one tiled pass
+//The sources are stored back to back in beliefs, with source_begin holding the first row of each in order
+//The result is row-major, with one distance per source for every formula state
+//With tiers the distances are weighted, and neither side may hold cubes
+std::vector<unsigned long> source_min_distances(const packed_states& formula,
+        const packed_states& beliefs, const std::vector<unsigned long>& source_begin,
+        const tier_masks* tiers = nullptr) noexcept;
+
+//Selects the minimum distance and every index that achieves it, using thread-local collectors
+min_collector collect_minimum(const std::vector<unsigned long>& distances);
+
+//Selects the layer_count smallest distances and every index at each of them, using thread-local collectors
+layer_collector collect_layers(
+        const std::vector<unsigned long>& distances, const unsigned long layer_count);
+
+#endif
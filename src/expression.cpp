@@ -0,0 +1,512 @@
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "expression.h"
+#include "packed.h"
+#include "plugin.h"
+#include "preorder_plugin.h"
+
+//Number of states evaluated side by side, so every instruction is a simple loop over this many lanes
+static constexpr unsigned long lane_count = 64;
+
+//Marks a counting operand that covers every variable
+static constexpr uint64_t unmasked = UINT64_MAX;
+
+//Variables are 32-bit literals everywhere else, so no variable set can mention one past this
+static constexpr unsigned long max_expression_variable = INT32_MAX;
+
+//The expression the scorer evaluates, which stays fixed once it is loaded
+static preorder_program loaded_program;
+
+namespace {
+//Entries on the shunting yard operator stack
+struct pending_operator {
+    enum class kind { OPERATOR, UNARY, PAREN, CALL } type;
+    preorder_opcode op;
+    int precedence;
+};
+} // namespace
+
+//Number of stack values an instruction consumes
+static unsigned long instruction_arity(const preorder_opcode op) noexcept {
+    switch (op) {
+        case preorder_opcode::CONSTANT:
+        case preorder_opcode::DIFF_COUNT:
+        case preorder_opcode::STATE_COUNT:
+        case preorder_opcode::BELIEF_COUNT:
+            return 0;
+        case preorder_opcode::NOT:
+            return 1;
+        case preorder_opcode::SELECT:
+            return 3;
+        default:
+            return 2;
+    }
+}
+
+//Reads a variable number, which must be written as plain digits and lie between 1 and max_expression_variable
+static bool parse_variable(const char* cursor, const char*& end, unsigned long& variable) noexcept {
+    if (!std::isdigit(static_cast<unsigned char>(*cursor))) {
+        return false;
+    }
+    char* number_end;
+    errno = 0;
+    variable = std::strtoul(cursor, &number_end, 10);
+    end = number_end;
+    return errno != ERANGE && variable != 0 && variable <= max_expression_variable;
+}
+
+//Parses a variable set like "1 3 5-8" into its ranges of variables
+static bool parse_variable_set(const std::string& text,
+        std::vector<std::pair<unsigned long, unsigned long>>& ranges) noexcept {
+    std::string list = text;
+    std::replace(list.begin(), list.end(), ',', ' ');
+
+    const char* cursor = list.c_str();
+    for (;;) {
+        while (std::isspace(static_cast<unsigned char>(*cursor))) {
+            ++cursor;
+        }
+        if (*cursor == '\0') {
+            break;
+        }
+        unsigned long first;
+        if (!parse_variable(cursor, cursor, first)) {
+            return false;
+        }
+        unsigned long last = first;
+        if (*cursor == '-') {
+            if (!parse_variable(cursor + 1, cursor, last) || last < first) {
+                return false;
+            }
+        }
+        ranges.emplace_back(first, last);
+    }
+    return !ranges.empty();
+}
+
+bool compile_preorder_expression(const std::string& text, preorder_program& program) noexcept {
+    program = preorder_program{};
+
+    std::vector<pending_operator> operator_stack;
+    //Arguments seen so far in each function call that is still open
+    std::vector<unsigned long> argument_counts;
+
+    const auto fail = [&](const std::string& reason) {
+        std::cerr << "Invalid pre-order expression: " << reason << "\n";
+        return false;
+    };
+    const auto emit = [&](const preorder_opcode op, const uint64_t value = 0) {
+        program.code.push_back({op, value});
+    };
+    //Pops every operator that binds at least as tightly as the given precedence
+    const auto pop_operators = [&](const int precedence) {
+        while (!operator_stack.empty()
+                && (operator_stack.back().type == pending_operator::kind::OPERATOR
+                        || operator_stack.back().type == pending_operator::kind::UNARY)
+                && operator_stack.back().precedence >= precedence) {
+            emit(operator_stack.back().op);
+            operator_stack.pop_back();
+        }
+    };
+
+    bool expect_operand = true;
+
+    unsigned long i = 0;
+    while (i < text.size()) {
+        const char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            ++i;
+            continue;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            if (!expect_operand) {
+                return fail("expected an operator before " + text.substr(i, 16));
+            }
+            char* end;
+            errno = 0;
+            const uint64_t value = std::strtoull(text.c_str() + i, &end, 10);
+            if (errno == ERANGE) {
+                return fail("integer literal " + text.substr(i, end - text.c_str() - i) + " is too large");
+            }
+            i = end - text.c_str();
+            emit(preorder_opcode::CONSTANT, value);
+            expect_operand = false;
+            continue;
+        }
+
+        if (std::isalpha(static_cast<unsigned char>(c))) {
+            unsigned long end = i;
+            while (end < text.size() && std::isalpha(static_cast<unsigned char>(text[end]))) {
+                ++end;
+            }
+            const std::string word = text.substr(i, end - i);
+            i = end;
+
+            if (word == "and" || word == "or") {
+                if (expect_operand) {
+                    return fail("expected an operand before " + word);
+                }
+                const int precedence = (word == "and") ? 2 : 1;
+                pop_operators(precedence);
+                operator_stack.push_back({pending_operator::kind::OPERATOR,
+                        (word == "and") ? preorder_opcode::AND : preorder_opcode::OR, precedence});
+                expect_operand = true;
+                continue;
+            }
+            if (!expect_operand) {
+                return fail("expected an operator before " + word);
+            }
+            if (word == "not") {
+                operator_stack.push_back({pending_operator::kind::UNARY, preorder_opcode::NOT, 6});
+                continue;
+            }
+            if (word == "min" || word == "max" || word == "if") {
+                const auto op = (word == "min") ? preorder_opcode::MIN
+                        : (word == "max")       ? preorder_opcode::MAX
+                                                : preorder_opcode::SELECT;
+                while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i]))) {
+                    ++i;
+                }
+                if (i == text.size() || text[i] != '(') {
+                    return fail(word + " must be followed by its arguments in parentheses");
+                }
+                ++i;
+                operator_stack.push_back({pending_operator::kind::CALL, op, 0});
+                argument_counts.push_back(1);
+                continue;
+            }
+            if (word == "diff" || word == "state" || word == "belief") {
+                const auto op = (word == "diff") ? preorder_opcode::DIFF_COUNT
+                        : (word == "state")      ? preorder_opcode::STATE_COUNT
+                                                 : preorder_opcode::BELIEF_COUNT;
+                uint64_t mask_index = unmasked;
+                if (i < text.size() && text[i] == '{') {
+                    const auto close = text.find('}', i);
+                    if (close == std::string::npos) {
+                        return fail("unterminated variable set after " + word);
+                    }
+                    std::vector<std::pair<unsigned long, unsigned long>> ranges;
+                    if (!parse_variable_set(text.substr(i + 1, close - i - 1), ranges)) {
+                        return fail("bad variable set after " + word);
+                    }
+                    i = close + 1;
+                    for (const auto& range : ranges) {
+                        program.variable_count = std::max(program.variable_count, range.second);
+                    }
+                    mask_index = program.variable_sets.size();
+                    program.variable_sets.push_back(std::move(ranges));
+                }
+                program.uses_beliefs |= (op != preorder_opcode::STATE_COUNT);
+                emit(op, mask_index);
+                expect_operand = false;
+                continue;
+            }
+            return fail("unknown word " + word);
+        }
+
+        if (c == '(') {
+            if (!expect_operand) {
+                return fail("expected an operator before (");
+            }
+            operator_stack.push_back({pending_operator::kind::PAREN, preorder_opcode::CONSTANT, 0});
+            ++i;
+            continue;
+        }
+        if (c == ',' || c == ')') {
+            if (expect_operand) {
+                return fail(std::string{"expected an operand before "} + c);
+            }
+            pop_operators(0);
+            if (operator_stack.empty()
+                    || (operator_stack.back().type != pending_operator::kind::PAREN
+                            && operator_stack.back().type != pending_operator::kind::CALL)) {
+                return fail(std::string{"unbalanced "} + c);
+            }
+            const bool is_call = (operator_stack.back().type == pending_operator::kind::CALL);
+            if (c == ',') {
+                if (!is_call) {
+                    return fail("commas can only separate function arguments");
+                }
+                ++argument_counts.back();
+                expect_operand = true;
+            } else {
+                const auto op = operator_stack.back().op;
+                operator_stack.pop_back();
+                if (is_call) {
+                    if (argument_counts.back() != instruction_arity(op)) {
+                        return fail("wrong number of function arguments");
+                    }
+                    argument_counts.pop_back();
+                    emit(op);
+                }
+            }
+            ++i;
+            continue;
+        }
+
+        //Binary operators, with the two character comparisons checked first
+        const std::string pair = text.substr(i, 2);
+        preorder_opcode op;
+        int precedence;
+        unsigned long length = 1;
+        if (pair == "<=" || pair == ">=" || pair == "==" || pair == "!=") {
+            op = (pair == "<=")   ? preorder_opcode::LESS_EQUAL
+                    : (pair == ">=") ? preorder_opcode::GREATER_EQUAL
+                    : (pair == "==") ? preorder_opcode::EQUAL
+                                     : preorder_opcode::NOT_EQUAL;
+            precedence = 3;
+            length = 2;
+        } else if (c == '<' || c == '>') {
+            op = (c == '<') ? preorder_opcode::LESS : preorder_opcode::GREATER;
+            precedence = 3;
+        } else if (c == '+' || c == '-') {
+            op = (c == '+') ? preorder_opcode::ADD : preorder_opcode::SUB;
+            precedence = 4;
+        } else if (c == '*') {
+            op = preorder_opcode::MUL;
+            precedence = 5;
+        } else {
+            return fail(std::string{"unknown character "} + c);
+        }
+        if (expect_operand) {
+            return fail("expected an operand before " + text.substr(i, length));
+        }
+        pop_operators(precedence);
+        operator_stack.push_back({pending_operator::kind::OPERATOR, op, precedence});
+        i += length;
+        expect_operand = true;
+    }
+
+    if (expect_operand) {
+        return fail("expression ends without an operand");
+    }
+    pop_operators(0);
+    if (!operator_stack.empty()) {
+        return fail("unbalanced (");
+    }
+
+    //Every operand and operator was checked on the way in, so this only has to track the stack depth
+    unsigned long depth = 0;
+    for (const auto& instruction : program.code) {
+        depth = depth - instruction_arity(instruction.op) + 1;
+        program.max_depth = std::max(program.max_depth, depth);
+    }
+
+    return true;
+}
+
+bool bind_preorder_program(preorder_program& program, const unsigned long state_length) noexcept {
+    if (program.variable_count > state_length) {
+        std::cerr << "Invalid pre-order expression: variable " << program.variable_count
+                  << " is past the belief length of " << state_length << "\n";
+        return false;
+    }
+
+    const unsigned long word_count = words_for_length(state_length);
+    program.masks.assign(program.variable_sets.size(), std::vector<uint64_t>(word_count, 0));
+    for (unsigned long m = 0; m < program.variable_sets.size(); ++m) {
+        for (const auto& [first, last] : program.variable_sets[m]) {
+            for (unsigned long v = first - 1; v < last; ++v) {
+                program.masks[m][v / 64] |= 1ull << (v % 64);
+            }
+        }
+    }
+    return true;
+}
+
+//Masked popcount of a packed row, or of its difference from another row when one is given
+//Bound masks are exactly as many words long as the rows
+static inline uint64_t masked_count(const uint64_t* row, const uint64_t* other,
+        const preorder_program& program, const uint64_t mask_index,
+        const unsigned long word_count) noexcept {
+    const uint64_t* mask = (mask_index == unmasked) ? nullptr : program.masks[mask_index].data();
+
+    uint64_t count = 0;
+    for (unsigned long k = 0; k < word_count; ++k) {
+        uint64_t word = (other) ? row[k] ^ other[k] : row[k];
+        if (mask) {
+            word &= mask[k];
+        }
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+//Evaluates the program for up to lane_count consecutive states against a single belief
+//The stack holds max_depth rows of lane_count values, and the result is left in its first row
+static void evaluate_lanes(const preorder_program& program, const uint64_t* states,
+        const unsigned long count, const uint64_t* belief, const unsigned long word_count,
+        uint64_t* stack) noexcept {
+    unsigned long top = 0;
+    for (const auto& instruction : program.code) {
+        uint64_t* const a = stack + (top - std::min(top, 2ul)) * lane_count;
+        uint64_t* const b = stack + (top - std::min(top, 1ul)) * lane_count;
+        uint64_t* const push = stack + top * lane_count;
+
+        switch (instruction.op) {
+            case preorder_opcode::CONSTANT:
+                std::fill(push, push + count, instruction.value);
+                break;
+            case preorder_opcode::DIFF_COUNT:
+                for (unsigned long l = 0; l < count; ++l) {
+                    push[l] = masked_count(
+                            states + l * word_count, belief, program, instruction.value, word_count);
+                }
+                break;
+            case preorder_opcode::STATE_COUNT:
+                for (unsigned long l = 0; l < count; ++l) {
+                    push[l] = masked_count(
+                            states + l * word_count, nullptr, program, instruction.value, word_count);
+                }
+                break;
+            case preorder_opcode::BELIEF_COUNT:
+                std::fill(push, push + count,
+                        masked_count(belief, nullptr, program, instruction.value, word_count));
+                break;
+            case preorder_opcode::NOT:
+                for (unsigned long l = 0; l < count; ++l) {
+                    b[l] = !b[l];
+                }
+                break;
+            case preorder_opcode::MUL:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] *= b[l];
+                }
+                break;
+            case preorder_opcode::ADD:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] += b[l];
+                }
+                break;
+            case preorder_opcode::SUB:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = (a[l] > b[l]) ? a[l] - b[l] : 0;
+                }
+                break;
+            case preorder_opcode::LESS:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] < b[l];
+                }
+                break;
+            case preorder_opcode::LESS_EQUAL:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] <= b[l];
+                }
+                break;
+            case preorder_opcode::GREATER:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] > b[l];
+                }
+                break;
+            case preorder_opcode::GREATER_EQUAL:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] >= b[l];
+                }
+                break;
+            case preorder_opcode::EQUAL:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] == b[l];
+                }
+                break;
+            case preorder_opcode::NOT_EQUAL:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] != b[l];
+                }
+                break;
+            case preorder_opcode::AND:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] && b[l];
+                }
+                break;
+            case preorder_opcode::OR:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = a[l] || b[l];
+                }
+                break;
+            case preorder_opcode::MIN:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = std::min(a[l], b[l]);
+                }
+                break;
+            case preorder_opcode::MAX:
+                for (unsigned long l = 0; l < count; ++l) {
+                    a[l] = std::max(a[l], b[l]);
+                }
+                break;
+            case preorder_opcode::SELECT: {
+                uint64_t* const condition = stack + (top - 3) * lane_count;
+                for (unsigned long l = 0; l < count; ++l) {
+                    condition[l] = (condition[l]) ? a[l] : b[l];
+                }
+                break;
+            }
+        }
+        top = top - instruction_arity(instruction.op) + 1;
+    }
+}
+
+//Block scorer with the same contract as a plugin's score function, evaluating the loaded expression
+static void expression_score(const uint64_t* states, uint64_t state_count, const uint64_t* beliefs,
+        uint64_t belief_count, uint64_t, uint64_t word_count, uint64_t* scores) {
+    const preorder_program& program = loaded_program;
+    assert(program.masks.size() == program.variable_sets.size());
+    assert(program.masks.empty() || program.masks.front().size() == word_count);
+
+    //Without any belief operands, the first belief gives the same score as all of them
+    const uint64_t belief_passes = (program.uses_beliefs) ? belief_count : 1;
+
+    std::vector<uint64_t> stack(program.max_depth * lane_count);
+
+    for (uint64_t begin = 0; begin < state_count; begin += lane_count) {
+        const unsigned long count = std::min<uint64_t>(lane_count, state_count - begin);
+        const uint64_t* lanes = states + begin * word_count;
+
+        std::fill(scores + begin, scores + begin + count, UINT64_MAX);
+        for (uint64_t j = 0; j < belief_passes; ++j) {
+            evaluate_lanes(program, lanes, count, beliefs + j * word_count, word_count, stack.data());
+            for (unsigned long l = 0; l < count; ++l) {
+                scores[begin + l] = std::min(scores[begin + l], stack[l]);
+            }
+        }
+    }
+}
+
+bool load_preorder_expression(const char* path) noexcept {
+    std::ifstream ifs{path};
+    if (!ifs) {
+        std::cerr << "Unable to open pre-order expression file " << path << "\n";
+        return false;
+    }
+
+    std::string text;
+    for (std::string line; std::getline(ifs, line);) {
+        if (line.size() >= 1 && line.front() == 'c'
+                && (line.size() == 1 || std::isspace(static_cast<unsigned char>(line[1])))) {
+            continue;
+        }
+        text += line;
+        text += ' ';
+    }
+
+    if (!compile_preorder_expression(text, loaded_program)) {
+        return false;
+    }
+
+    use_preorder_scorer(expression_score);
+    return true;
+}
+
+bool bind_preorder_expression(const unsigned long state_length) noexcept {
+    return bind_preorder_program(loaded_program, state_length);
+}
@@ -0,0 +1,79 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+//Pre-order expressions, compiled once into postfix bytecode that scores a block of packed states at a time
+//An expression is evaluated for every (state, belief) pair, and a state's score is the minimum over the beliefs
+//Every value is an unsigned integer, where comparisons and logical operators produce 0 or 1
+//
+//Operands:
+//  123                     - integer literal
+//  diff, diff{1 3 5-8}     - number of differing variables between the state and the belief, optionally masked
+//  state{...}, belief{...} - number of set variables in the state or the belief, where state{3} tests variable 3
+//Operators, from tightest to loosest binding:
+//  not, then *, then + and - (which stops at 0), then < <= > >= == !=, then and, then or
+//Functions:
+//  min(a, b), max(a, b), if(condition, then, else)
+
+enum class preorder_opcode {
+    CONSTANT,
+    DIFF_COUNT,
+    STATE_COUNT,
+    BELIEF_COUNT,
+    NOT,
+    MUL,
+    ADD,
+    SUB,
+    LESS,
+    LESS_EQUAL,
+    GREATER,
+    GREATER_EQUAL,
+    EQUAL,
+    NOT_EQUAL,
+    AND,
+    OR,
+    MIN,
+    MAX,
+    SELECT
+};
+
+struct preorder_instruction {
+    preorder_opcode op;
+    //The literal for constants, and the index into masks for the counting operands
+    uint64_t value;
+};
+
+struct preorder_program {
+    std::vector<preorder_instruction> code;
+    //Each variable set as the 1-based ranges it lists, kept until the belief length is known
+    std::vector<std::vector<std::pair<unsigned long, unsigned long>>> variable_sets;
+    //Highest variable any set mentions
+    unsigned long variable_count = 0;
+    //One mask per variable set in the packed state layout, built by bind_preorder_program
+    std::vector<std::vector<uint64_t>> masks;
+    //Largest number of values on the evaluation stack at once
+    unsigned long max_depth = 0;
+    //Whether any instruction looks at the belief, otherwise every belief gives the same score
+    bool uses_beliefs = false;
+};
+
+//Compiles the expression text into bytecode using the shunting yard algorithm
+//Returns false, after printing the reason, if the expression is malformed
+bool compile_preorder_expression(const std::string& text, preorder_program& program) noexcept;
+
+//Builds the program's masks for states of the given length, which every scored state must then have
+//Returns false, after printing the reason, if a variable set mentions a variable past the state length
+bool bind_preorder_program(preorder_program& program, unsigned long state_length) noexcept;
+
+//Binds the loaded expression to the belief length, once the beliefs have been read
+bool bind_preorder_expression(unsigned long state_length) noexcept;
+
+//Reads and compiles a pre-order expression file, then makes it the active block pre-order
+//Lines starting with 'c' followed by whitespace are comments, and the other lines are joined into one expression
+bool load_preorder_expression(const char* path) noexcept;
+
+#endif
@@ -13,6 +13,7 @@
 #include <bitset>
 #include <unordered_set>
 #include "file.h"
+#include "packed.h"
 
 //Returns an enum along with a variant, where the enum says what type the variant has
 //This means this same piece of code can parse all 3 accepted input formats without needing seperate functions
@@ -255,6 +256,18 @@ std::vector<std::vector<bool>> convert_dnf_to_raw(const std::vector<std::vector<
     return output;
 }
 
+//Unlike convert_dnf_to_raw, nothing is padded, so the size stays linear in the number of terms
+packed_states convert_dnf_to_cubes(const std::vector<std::vector<int32_t>>& clause_list) noexcept {
+    int32_t variable_count = 0;
+    for (const auto& clause : clause_list) {
+        for (const auto term : clause) {
+            variable_count = std::max(variable_count, std::abs(term));
+        }
+    }
+
+    return pack_cubes(clause_list, variable_count);
+}
+
 std::unordered_map<int32_t, unsigned long> read_pd_ordering(const char *path) noexcept {
     std::ifstream file{path};
 
@@ -309,3 +322,51 @@ std::unordered_map<int32_t, unsigned long> read_pd_ordering(const char *path) no
     return orderings;
 }
 
+std::unordered_map<int32_t, unsigned long> read_weights(const char *path) noexcept {
+    std::ifstream file{path};
+
+    if (!file) {
+        std::cerr << "Unable to open file " << strerror(errno) << "\n";
+        std::cerr << path << "\n";
+        return {};
+    }
+
+    std::unordered_map<int32_t, unsigned long> weights;
+    int32_t max_variable = -1;
+
+    for (std::string line; std::getline(file, line);) {
+        //Ignore empty lines
+        if (line.empty()) {
+            continue;
+        }
+
+        for (const auto c : line) {
+            if (!std::isdigit(c) && !std::isspace(c)) {
+                std::cerr << "Line contained invalid character\n";
+                return {};
+            }
+        }
+
+        std::istringstream iss{std::move(line)};
+        int32_t variable_num;
+        unsigned long weight;
+
+        if (!(iss >> variable_num >> weight)) {
+            std::cerr << "Weight lines must contain a variable and its weight\n";
+            return {};
+        }
+        if (variable_num <= 0) {
+            std::cerr << "Variable numbers must be positive\n";
+            return {};
+        }
+        weights[variable_num] = weight;
+        max_variable = std::max(variable_num, max_variable);
+    }
+
+    //Unlisted variables keep the default weight, so the variables stay contiguous like pd orderings
+    for (auto i = 1; i < max_variable; ++i) {
+        weights.emplace(i, 1);
+    }
+
+    return weights;
+}
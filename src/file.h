@@ -7,6 +7,7 @@
 #include <fstream>
 #include <variant>
 #include <unordered_map>
+#include "packed.h"
 
 enum class type_format {
     CNF,
@@ -26,6 +27,12 @@ std::vector<std::vector<int32_t>> convert_raw(const std::vector<std::vector<bool
 //Converts between DNF vectors and bool vectors
 std::vector<std::vector<bool>> convert_dnf_to_raw(const std::vector<std::vector<int32_t>>& clause_list) noexcept;
 
+//Converts DNF vectors into packed cubes, leaving every unset variable as a don't care
+packed_states convert_dnf_to_cubes(const std::vector<std::vector<int32_t>>& clause_list) noexcept;
+
 std::unordered_map<int32_t, unsigned long> read_pd_ordering(const char *path) noexcept;
 
+//Reads per-variable weights from lines of "variable weight", where unlisted variables have a weight of 1
+std::unordered_map<int32_t, unsigned long> read_weights(const char *path) noexcept;
+
 #endif
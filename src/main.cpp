@@ -1,12 +1,21 @@
 #include <iostream>
 #include <cstdlib>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <variant>
 #include <unistd.h>
 #include <getopt.h>
 #include "file.h"
 #include "belief.h"
 #include "interactive.h"
+#include "plugin.h"
+#include "expression.h"
 
 static struct option long_options[] = {
     {"belief_set",  required_argument, 0, 'b'},
@@ -16,6 +25,21 @@ static struct option long_options[] = {
     {"dalal",       no_argument,       0, 'd'},
     {"verbose",     no_argument,       0, 'v'},
     {"output",      required_argument, 0, 'o'},
+    {"mih",         no_argument,       0, 'm'},
+    {"vertical",    no_argument,       0, 'V'},
+    {"pivots",      required_argument, 0, 't'},
+    {"engine",      required_argument, 0, 'e'},
+    {"weights",     required_argument, 0, 'w'},
+    {"layers",      required_argument, 0, 'l'},
+    {"operator",    required_argument, 0, 'r'},
+    {"update",      no_argument,       0, 'u'},
+    {"aggregate",   required_argument, 0, 'a'},
+    {"contract",    no_argument,       0, 'c'},
+    {"sequence",    required_argument, 0, 's'},
+    {"batch",       required_argument, 0, 'B'},
+    {"jobs",        required_argument, 0, 'j'},
+    {"preorder",    required_argument, 0, 'P'},
+    {"expression",  required_argument, 0, 'x'},
     {0,         0,                 0, 0}
 };
 
@@ -23,28 +47,114 @@ static struct option long_options[] = {
     do { \
         printf("usage options:\n"\
                 "\t [i]nteractive           - Run the application in interactive mode\n"\
-                "\t [b]elief_set            - The file path of the initial belief set\n"\
+                "\t [b]elief_set            - The file path of the initial belief set, given more than once to merge them\n"\
                 "\t [f]ormula               - The file path of the revision formula\n"\
                 "\t [p]d-ordering           - The file path of the pd orderings\n"\
                 "\t [d]alal                 - Use the Dalal pre-order (Hamming distance)\n"\
                 "\t [v]erbose               - Output in verbose mode\n"\
                 "\t [o]utput                - File to output revised beliefse to\n"\
+                "\t [m]ih                   - Index the belief set using multi-index hashing\n"\
+                "\t [V]ertical              - Store the belief set as bit-planes and score blocks of beliefs at once\n"\
+                "\t pivo[t]s                - Number of pivot beliefs used to prune the scan with the triangle inequality\n"\
+                "\t [e]ngine                - Revision engine to use: auto, enumerate, radius, or sat\n"\
+                "\t [w]eights               - The file path of per-variable weights, used instead of pd orderings\n"\
+                "\t [l]ayers                - Output the states at the closest K distances, instead of only the closest\n"\
+                "\t ope[r]ator              - Revision operator to use: dalal, satoh, or weber\n"\
+                "\t [u]pdate                - Keep the closest formula states to each belief, instead of to the whole set\n"\
+                "\t [a]ggregate             - How merged belief sets combine their distances: sum, max, or gmax\n"\
+                "\t [c]ontract              - Contract the belief set by the formula, instead of revising it\n"\
+                "\t [s]equence              - File listing formula paths to revise by in order, used instead of the formula\n"\
+                "\t [B]atch                 - File listing formula paths to revise the same beliefs by, each with its own output\n"\
+                "\t [j]obs                  - Number of formulas to revise at once in batch mode, defaulting to the thread count\n"\
+                "\t [P]reorder              - Shared library of a pre-order plugin to use instead of the Dalal pre-order\n"\
+                "\t e[x]pression            - File holding a pre-order expression to use instead of the Dalal pre-order\n"\
                 "\t [h]elp                  - this message\n"\
                 "If interactive mode is not specified, the belief_set and formula paths must be provided\n"\
                 );\
     } while(0)
 
+//Reads a belief file and converts it to raw states, returning nothing if the file can't be parsed
+//When cubes is given, DNF and CNF terms are packed into it as cubes instead of being expanded into raw states
+static std::vector<std::vector<bool>> read_belief_states(const char *path, packed_states *cubes = nullptr) {
+    auto [format, beliefs] = read_file(path);
+
+    if (format == type_format::RAW) {
+        const auto states = std::get_if<std::vector<std::vector<bool>>>(&beliefs);
+        return (states) ? *states : std::vector<std::vector<bool>>{};
+    }
+    auto terms = std::get_if<std::vector<std::vector<int32_t>>>(&beliefs);
+    if (!terms || terms->empty()) {
+        return {};
+    }
+    if (format == type_format::CNF) {
+        //Convert CNF to DNF
+        *terms = convert_normal_forms(*terms);
+    }
+
+    const auto abs_cmp = [](const auto a, const auto b){return std::abs(a) < std::abs(b);};
+
+    for (auto& clause : *terms) {
+        std::sort(clause.begin(), clause.end(), abs_cmp);
+    }
+    std::sort(terms->begin(), terms->end());
+
+    if (cubes) {
+        *cubes = convert_dnf_to_cubes(*terms);
+        return {};
+    }
+    return convert_dnf_to_raw(*terms);
+}
+
+//Reads a formula file and converts it to CNF, returning nothing if the file can't be parsed
+static std::vector<std::vector<int32_t>> read_formula_clauses(const char *path) {
+    auto [format, formula] = read_file(path);
+
+    if (format == type_format::RAW) {
+        const auto states = std::get_if<std::vector<std::vector<bool>>>(&formula);
+        if (!states || states->empty()) {
+            return {};
+        }
+        formula = convert_raw(*states);
+    }
+    auto terms = std::get_if<std::vector<std::vector<int32_t>>>(&formula);
+    if (!terms || terms->empty()) {
+        return {};
+    }
+    if (format == type_format::CNF) {
+        return *terms;
+    }
+    if (terms->size() > 1) {
+        return convert_normal_forms(*terms);
+    }
+    //A single DNF term is a conjunction of unit clauses
+    std::vector<std::vector<int32_t>> converted_form;
+    for (const auto term : terms->front()) {
+        converted_form.push_back({term});
+    }
+    return converted_form;
+}
+
 int main(int argc, char **argv) {
     const char *belief_path = nullptr;
     const char *formula_path = nullptr;
     const char *pd_path = nullptr;
+    const char *weights_path = nullptr;
+    const char *sequence_path = nullptr;
+    const char *batch_path = nullptr;
+    const char *plugin_path = nullptr;
+    const char *expression_path = nullptr;
+    unsigned long jobs = 0;
+    std::vector<const char *> belief_paths;
+    merge_aggregate aggregate = merge_aggregate::SUM;
     const char *output_file = nullptr;
     bool is_interactive = false;
     bool use_pd_ordering = false;
+    bool contracting = false;
+    revision_options options;
     for (;;) {
         int c;
         int option_index = 0;
-        if ((c = getopt_long(argc, argv, "b:f:ihp:dvo:", long_options, &option_index)) == -1) {
+        if ((c = getopt_long(argc, argv, "b:f:ihp:dvo:mVt:e:w:l:r:ua:cs:B:j:P:x:", long_options, &option_index)) == -1) {
             break;
         }
         switch (c) {
@@ -53,6 +163,7 @@ int main(int argc, char **argv) {
                 break;
             case 'b':
                 belief_path = optarg;
+                belief_paths.push_back(optarg);
                 break;
             case 'f':
                 formula_path = optarg;
@@ -64,12 +175,105 @@ int main(int argc, char **argv) {
                 use_pd_ordering = true;
                 pd_path = optarg;
                 break;
+            case 'w':
+                use_pd_ordering = true;
+                weights_path = optarg;
+                break;
+            case 'l':
+                options.layers = strtoul(optarg, nullptr, 10);
+                if (options.layers == 0) {
+                    std::cerr << "Layer count must be a positive number\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
             case 'v':
                 verbose = true;
                 break;
             case 'o':
                 output_file = optarg;
                 break;
+            case 'm':
+                options.use_mih_index = true;
+                break;
+            case 'V':
+                options.use_vertical_layout = true;
+                break;
+            case 't':
+                options.pivot_count = strtoul(optarg, nullptr, 10);
+                if (options.pivot_count == 0) {
+                    std::cerr << "Pivot count must be a positive number\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'e':
+                if (strcmp(optarg, "auto") == 0) {
+                    options.engine = revision_engine::AUTO;
+                } else if (strcmp(optarg, "enumerate") == 0) {
+                    options.engine = revision_engine::ENUMERATE;
+                } else if (strcmp(optarg, "radius") == 0) {
+                    options.engine = revision_engine::RADIUS;
+                } else if (strcmp(optarg, "sat") == 0) {
+                    options.engine = revision_engine::SAT;
+                } else {
+                    std::cerr << "Unknown revision engine " << optarg << "\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'r':
+                if (strcmp(optarg, "dalal") == 0) {
+                    options.op = revision_operator::DALAL;
+                } else if (strcmp(optarg, "satoh") == 0) {
+                    options.op = revision_operator::SATOH;
+                } else if (strcmp(optarg, "weber") == 0) {
+                    options.op = revision_operator::WEBER;
+                } else {
+                    std::cerr << "Unknown revision operator " << optarg << "\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'u':
+                options.update = true;
+                break;
+            case 'a':
+                if (strcmp(optarg, "sum") == 0) {
+                    aggregate = merge_aggregate::SUM;
+                } else if (strcmp(optarg, "max") == 0) {
+                    aggregate = merge_aggregate::MAX;
+                } else if (strcmp(optarg, "gmax") == 0) {
+                    aggregate = merge_aggregate::GMAX;
+                } else {
+                    std::cerr << "Unknown merge aggregate " << optarg << "\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'c':
+                contracting = true;
+                break;
+            case 's':
+                sequence_path = optarg;
+                break;
+            case 'B':
+                batch_path = optarg;
+                break;
+            case 'P':
+                plugin_path = optarg;
+                break;
+            case 'x':
+                expression_path = optarg;
+                break;
+            case 'j':
+                jobs = strtoul(optarg, nullptr, 10);
+                if (jobs == 0) {
+                    std::cerr << "Job count must be a positive number\n";
+                    print_help();
+                    return EXIT_FAILURE;
+                }
+                break;
             case 'h':
                 [[fallthrough]];
             case '?':
@@ -79,11 +283,81 @@ int main(int argc, char **argv) {
                 return EXIT_SUCCESS;
         }
     }
+    if (pd_path && weights_path) {
+        std::cerr << "PD orderings and weights cannot be used together\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (options.use_mih_index + options.use_vertical_layout + (options.pivot_count != 0) > 1) {
+        std::cerr << "Only one of the multi-index hash, the vertical layout, and pivots can be used\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (options.op != revision_operator::DALAL && (use_pd_ordering || options.layers > 1)) {
+        std::cerr << "Only the Dalal operator supports pd orderings, weights, and layers\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (options.update && (options.op != revision_operator::DALAL || options.layers > 1)) {
+        std::cerr << "Update mode only supports the Dalal operator without layers\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    //Several belief sets are merged, with the first one read like a single belief set would be
+    const bool merging = belief_paths.size() > 1;
+    if (merging) {
+        belief_path = belief_paths.front();
+        if (options.op != revision_operator::DALAL || options.update || options.layers > 1) {
+            std::cerr << "Merging only supports the Dalal operator without update or layers\n";
+            print_help();
+            return EXIT_FAILURE;
+        }
+    }
+    if (contracting
+            && (options.op != revision_operator::DALAL || options.update || options.layers > 1 || merging)) {
+        std::cerr << "Contraction only supports the Dalal operator without update, layers, or merging\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (sequence_path && (options.layers > 1 || merging || contracting)) {
+        std::cerr << "Formula sequences can't be used with layers, merging, or contraction\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (batch_path && (options.layers > 1 || merging || contracting || sequence_path || output_file)) {
+        std::cerr << "Batch mode writes one output per formula, and can't be used with layers, merging, "
+                     "contraction, sequences, or an output file\n";
+        print_help();
+        return EXIT_FAILURE;
+    }
+    if (plugin_path || expression_path) {
+        if (plugin_path && expression_path) {
+            std::cerr << "Pre-order plugins and expressions cannot be used together\n";
+            print_help();
+            return EXIT_FAILURE;
+        }
+        if (use_pd_ordering || options.op != revision_operator::DALAL || options.engine == revision_engine::RADIUS
+                || options.engine == revision_engine::SAT) {
+            std::cerr << "Pre-order plugins and expressions can't be used with pd orderings, weights, other operators, or the radius and sat engines\n";
+            print_help();
+            return EXIT_FAILURE;
+        }
+        if (plugin_path && !load_preorder_plugin(plugin_path)) {
+            return EXIT_FAILURE;
+        }
+        if (expression_path && !load_preorder_expression(expression_path)) {
+            return EXIT_FAILURE;
+        }
+        total_preorder = plugin_preorder;
+    }
     //Not currently supporting interactive mode yet
     if (is_interactive) {
         std::cout << "Entering interactive mode\n";
         auto [beliefs, formula] = run_interactive_mode();
 
+        if (expression_path && !beliefs.empty() && !bind_preorder_expression(beliefs.front().size())) {
+            return EXIT_FAILURE;
+        }
         if (verbose) {
             std::cout << "Initial belief states:\n";
             for (const auto& state : beliefs) {
@@ -102,11 +376,12 @@ int main(int argc, char **argv) {
             }
         }
         if (use_pd_ordering) {
-            if (pd_path == nullptr) {
+            if (pd_path == nullptr && weights_path == nullptr) {
                 std::cerr << "PD path was null when it shouldn't be\n";
                 return EXIT_FAILURE;
             }
-            const auto orderings = read_pd_ordering(pd_path);
+            const auto orderings
+                    = (weights_path) ? read_weights(weights_path) : read_pd_ordering(pd_path);
             if (orderings.empty()) {
                 std::cerr << "Error reading pd ordering file\n";
                 return EXIT_FAILURE;
@@ -129,20 +404,85 @@ int main(int argc, char **argv) {
                     std::cout << p.first << " " << p.second << "\n";
                 }
             }
-            revise_beliefs(beliefs, formula, orderings, output_file);
+            revise_beliefs(beliefs, formula, orderings, output_file, options);
         } else {
-            revise_beliefs(beliefs, formula, {}, output_file);
+            revise_beliefs(beliefs, formula, {}, output_file, options);
         }
 
         return EXIT_SUCCESS;
     }
-    if (!belief_path || !formula_path) {
+    if (!belief_path || (!formula_path && !sequence_path && !batch_path)) {
         std::cerr << "Required file inputs were not provided\n";
         print_help();
         return EXIT_FAILURE;
     }
+    if (sequence_path || batch_path) {
+        //Every formula is read up front, so the timings only cover the revisions themselves
+        std::ifstream ifs{(sequence_path) ? sequence_path : batch_path};
+        if (!ifs) {
+            std::cerr << "Unable to open formula list file\n";
+            return EXIT_FAILURE;
+        }
+        std::vector<std::vector<std::vector<int32_t>>> formulas;
+        std::vector<std::string> output_files;
+        for (std::string line; std::getline(ifs, line);) {
+            std::istringstream iss{line};
+            std::string formula_file;
+            std::string formula_output;
+            if (!(iss >> formula_file)) {
+                continue;
+            }
+            //Batch outputs default to the formula path with an extra extension
+            if (!(iss >> formula_output)) {
+                formula_output = formula_file + ".out";
+            }
+            auto clauses = read_formula_clauses(formula_file.c_str());
+            if (clauses.empty()) {
+                std::cerr << "Error parsing formula file " << formula_file << "\n";
+                return EXIT_FAILURE;
+            }
+            formulas.push_back(std::move(clauses));
+            output_files.push_back(std::move(formula_output));
+        }
+        if (formulas.empty()) {
+            std::cerr << "Formula list file lists no formulas\n";
+            return EXIT_FAILURE;
+        }
+
+        //Pd orderings need full states, otherwise DNF beliefs stay as cubes
+        packed_states resident;
+        const auto states = read_belief_states(belief_path, (use_pd_ordering) ? nullptr : &resident);
+        if (!states.empty()) {
+            resident = pack_states(states);
+        }
+        if (resident.size == 0) {
+            std::cerr << "Error parsing belief file\n";
+            return EXIT_FAILURE;
+        }
+        if (expression_path && !bind_preorder_expression(resident.state_length)) {
+            return EXIT_FAILURE;
+        }
+
+        std::unordered_map<int32_t, unsigned long> orderings;
+        if (use_pd_ordering) {
+            orderings = (weights_path) ? read_weights(weights_path) : read_pd_ordering(pd_path);
+            if (orderings.empty()) {
+                std::cerr << "Error reading pd ordering file\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (batch_path) {
+            batch_revision(resident, formulas, output_files, orderings, options, jobs);
+        } else {
+            iterate_revision(resident, formulas, orderings, output_file, options);
+        }
+
+        return EXIT_SUCCESS;
+    }
 
     auto [belief_format, beliefs] = read_file(belief_path);
+    packed_states belief_cubes;
 
     if ((belief_format != type_format::RAW && !std::get_if<std::vector<std::vector<int32_t>>>(&beliefs))
             || (belief_format == type_format::RAW && !std::get_if<std::vector<std::vector<bool>>>(&beliefs))) {
@@ -179,8 +519,22 @@ int main(int argc, char **argv) {
         }
         std::sort(std::get<std::vector<std::vector<int32_t>>>(beliefs).begin(), std::get<std::vector<std::vector<int32_t>>>(beliefs).end());
 
-        //Convert DNF to raw
-        beliefs = convert_dnf_to_raw(std::get<std::vector<std::vector<int32_t>>>(beliefs));
+        if (use_pd_ordering || merging || contracting) {
+            //Convert DNF to raw
+            beliefs = convert_dnf_to_raw(std::get<std::vector<std::vector<int32_t>>>(beliefs));
+        } else {
+            //Keep the DNF terms as cubes rather than expanding every completion
+            belief_cubes = convert_dnf_to_cubes(std::get<std::vector<std::vector<int32_t>>>(beliefs));
+        }
+    }
+    const bool use_cubes = belief_format != type_format::RAW && !use_pd_ordering && !merging && !contracting;
+    if (expression_path) {
+        const unsigned long belief_length = (use_cubes)
+                ? belief_cubes.state_length
+                : std::get<std::vector<std::vector<bool>>>(beliefs).front().size();
+        if (!bind_preorder_expression(belief_length)) {
+            return EXIT_FAILURE;
+        }
     }
     if (formula_format != type_format::CNF) {
         if (belief_format == type_format::RAW) {
@@ -204,11 +558,26 @@ int main(int argc, char **argv) {
     }
     if (verbose) {
         std::cout << "Initial belief states:\n";
-        for (const auto& state : std::get<std::vector<std::vector<bool>>>(beliefs)) {
-            for (unsigned long i = 0; i < state.size(); ++i) {
-                std::cout << state[i];
+        if (use_cubes) {
+            for (unsigned long i = 0; i < belief_cubes.size; ++i) {
+                const auto value = belief_cubes.row(i);
+                const auto care = belief_cubes.care_row(i);
+                for (unsigned long j = 0; j < belief_cubes.state_length; ++j) {
+                    if ((care[j / 64] >> (j % 64)) & 1) {
+                        std::cout << ((value[j / 64] >> (j % 64)) & 1);
+                    } else {
+                        std::cout << '-';
+                    }
+                }
+                std::cout << "\n";
+            }
+        } else {
+            for (const auto& state : std::get<std::vector<std::vector<bool>>>(beliefs)) {
+                for (unsigned long i = 0; i < state.size(); ++i) {
+                    std::cout << state[i];
+                }
+                std::cout << "\n";
             }
-            std::cout << "\n";
         }
         std::cout << "Revision formula:\n";
         for (const auto& clause : std::get<std::vector<std::vector<int32_t>>>(formula)) {
@@ -218,12 +587,29 @@ int main(int argc, char **argv) {
             std::cout << "\n";
         }
     }
+    std::vector<std::vector<std::vector<bool>>> sources;
+    if (merging) {
+        sources.push_back(std::get<std::vector<std::vector<bool>>>(beliefs));
+        for (auto it = std::next(belief_paths.cbegin()); it != belief_paths.cend(); ++it) {
+            auto source = read_belief_states(*it);
+            if (source.empty()) {
+                std::cerr << "Error parsing belief file " << *it << "\n";
+                return EXIT_FAILURE;
+            }
+            if (source.front().size() != sources.front().front().size()) {
+                std::cerr << "Merged belief sets must all have the same number of variables\n";
+                return EXIT_FAILURE;
+            }
+            sources.push_back(std::move(source));
+        }
+    }
     if (use_pd_ordering) {
-        if (pd_path == nullptr) {
+        if (pd_path == nullptr && weights_path == nullptr) {
             std::cerr << "PD path was null when it shouldn't be\n";
             return EXIT_FAILURE;
         }
-        const auto orderings = read_pd_ordering(pd_path);
+        const auto orderings
+                = (weights_path) ? read_weights(weights_path) : read_pd_ordering(pd_path);
         if (orderings.empty()) {
             std::cerr << "Error reading pd ordering file\n";
             return EXIT_FAILURE;
@@ -247,9 +633,21 @@ int main(int argc, char **argv) {
                 std::cout << p.first << " " << p.second << "\n";
             }
         }
-        revise_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), orderings, output_file);
+        if (merging) {
+            merge_beliefs(sources, std::get<std::vector<std::vector<int32_t>>>(formula), orderings, output_file, aggregate);
+        } else if (contracting) {
+            contract_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), orderings, output_file);
+        } else {
+            revise_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), orderings, output_file, options);
+        }
+    } else if (merging) {
+        merge_beliefs(sources, std::get<std::vector<std::vector<int32_t>>>(formula), {}, output_file, aggregate);
+    } else if (contracting) {
+        contract_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), {}, output_file);
+    } else if (use_cubes) {
+        revise_beliefs(belief_cubes, std::get<std::vector<std::vector<int32_t>>>(formula), {}, output_file, options);
     } else {
-        revise_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), {}, output_file);
+        revise_beliefs(std::get<std::vector<std::vector<bool>>>(beliefs), std::get<std::vector<std::vector<int32_t>>>(formula), {}, output_file, options);
     }
 
     return EXIT_SUCCESS;
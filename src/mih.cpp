@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <omp.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "distance.h"
+#include "mih.h"
+#include "packed.h"
+
+//Substrings are kept to 32 bits so the neighbour enumeration never overflows a 64-bit mask
+static constexpr unsigned long max_substring_length = 32;
+
+//Reads length bits starting at bit offset begin out of a packed row
+static inline uint64_t extract_bits(
+        const uint64_t* row, const unsigned long begin, const unsigned long length) noexcept {
+    const unsigned long word = begin / 64;
+    const unsigned long offset = begin % 64;
+
+    uint64_t value = row[word] >> offset;
+    if (offset + length > 64) {
+        value |= row[word + 1] << (64 - offset);
+    }
+    return value & ((1ull << length) - 1);
+}
+
+//Aim for substrings of about log2(belief count) bits, which keeps each table bucket small
+mih_index build_mih_index(const packed_states& beliefs, unsigned long substring_count) noexcept {
+    mih_index index;
+
+    const unsigned long state_length = beliefs.state_length;
+
+    if (substring_count == 0) {
+        const auto target_length = static_cast<unsigned long>(
+                std::max(1.0, std::log2(std::max(2ul, beliefs.size))));
+        substring_count = std::max(1ul, state_length / target_length);
+    }
+    substring_count = std::max(substring_count,
+            (state_length + max_substring_length - 1) / max_substring_length);
+    substring_count = std::min(substring_count, std::max(1ul, state_length));
+
+    index.substring_count = substring_count;
+    index.substring_begin.reserve(substring_count + 1);
+    for (unsigned long i = 0; i <= substring_count; ++i) {
+        index.substring_begin.push_back(i * state_length / substring_count);
+    }
+    index.tables.resize(substring_count);
+
+#pragma omp parallel for schedule(static)
+    for (unsigned long t = 0; t < substring_count; ++t) {
+        const unsigned long begin = index.substring_begin[t];
+        const unsigned long length = index.substring_begin[t + 1] - begin;
+
+        auto& table = index.tables[t];
+        for (unsigned long i = 0; i < beliefs.size; ++i) {
+            table[extract_bits(beliefs.row(i), begin, length)].push_back(i);
+        }
+    }
+
+    return index;
+}
+
+//Radius r is searched by flipping every combination of r bits in each query substring
+//Once radius r has been probed in every table, every belief within substring_count * (r + 1) - 1 has been seen
+//If enumerating the next radius would cost more than a linear scan, the remaining beliefs are scanned directly
+unsigned long mih_min_distance(const mih_index& index, const packed_states& beliefs,
+        const uint64_t* state, const unsigned long lower_bound, const unsigned long bound) noexcept {
+    const unsigned long word_count = beliefs.word_count;
+    const unsigned long substring_count = index.substring_count;
+
+    std::vector<uint64_t> query;
+    query.reserve(substring_count);
+    for (unsigned long t = 0; t < substring_count; ++t) {
+        const unsigned long begin = index.substring_begin[t];
+        query.push_back(extract_bits(state, begin, index.substring_begin[t + 1] - begin));
+    }
+
+    std::unordered_set<unsigned long> checked;
+    unsigned long min_dist = ULONG_MAX;
+    double probes = 0;
+
+    for (unsigned long radius = 0;; ++radius) {
+        double radius_probes = 0;
+        for (unsigned long t = 0; t < substring_count; ++t) {
+            const unsigned long length = index.substring_begin[t + 1] - index.substring_begin[t];
+            if (radius <= length) {
+                radius_probes += std::exp(std::lgamma(length + 1.0) - std::lgamma(radius + 1.0)
+                        - std::lgamma(length - radius + 1.0));
+            }
+        }
+        probes += radius_probes;
+
+        if (radius_probes == 0 || probes > beliefs.size) {
+            //Finish with a bounded linear scan over whatever has not already been checked
+            for (unsigned long i = 0; i < beliefs.size && min_dist > lower_bound; ++i) {
+                if (checked.count(i)) {
+                    continue;
+                }
+                const unsigned long cap = std::min(min_dist - 1, bound);
+                const unsigned long dist = bounded_distance(state, beliefs.row(i), word_count, cap);
+                if (dist <= cap) {
+                    min_dist = dist;
+                }
+            }
+            return min_dist;
+        }
+
+        for (unsigned long t = 0; t < substring_count; ++t) {
+            const unsigned long length = index.substring_begin[t + 1] - index.substring_begin[t];
+            if (radius > length) {
+                continue;
+            }
+            const auto& table = index.tables[t];
+
+            //Gosper's hack walks every length-bit mask with exactly radius bits set
+            uint64_t flips = (1ull << radius) - 1;
+            while (flips < (1ull << length)) {
+                const auto bucket = table.find(query[t] ^ flips);
+                if (bucket != table.cend()) {
+                    for (const auto i : bucket->second) {
+                        if (!checked.insert(i).second) {
+                            continue;
+                        }
+                        const unsigned long cap = std::min(min_dist - 1, bound);
+                        const unsigned long dist
+                                = bounded_distance(state, beliefs.row(i), word_count, cap);
+                        if (dist <= cap) {
+                            min_dist = dist;
+                            if (min_dist <= lower_bound) {
+                                return min_dist;
+                            }
+                        }
+                    }
+                }
+                if (flips == 0) {
+                    break;
+                }
+                const uint64_t lowest = flips & -flips;
+                const uint64_t ripple = flips + lowest;
+                flips = (((ripple ^ flips) >> 2) / lowest) | ripple;
+            }
+        }
+
+        //Everything closer than this has now been found
+        const unsigned long searched = substring_count * (radius + 1);
+        if (min_dist < searched || searched > bound) {
+            return min_dist;
+        }
+    }
+}
+
+min_collector mih_collect_min_distances(const mih_index& index, const packed_states& formula,
+        const packed_states& beliefs, const unsigned long lower_bound) noexcept {
+    assert(formula.word_count == beliefs.word_count);
+
+    min_collector output;
+    std::atomic<unsigned long> shared_bound{ULONG_MAX};
+
+#pragma omp parallel
+    {
+        min_collector local;
+
+#pragma omp for schedule(dynamic, 64) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            const unsigned long dist = mih_min_distance(index, beliefs, formula.row(i), lower_bound,
+                    shared_bound.load(std::memory_order_relaxed));
+            local.add(dist, i);
+
+            lower_shared_bound(shared_bound, dist);
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    return output;
+}
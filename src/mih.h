@@ -0,0 +1,36 @@
+#ifndef MIH_H
+#define MIH_H
+
+#include <climits>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+
+//Multi-index hashing over a packed belief set, for exact Hamming nearest neighbour queries
+//Each state is split into contiguous substrings, and each substring position gets its own hash table
+//If a belief is within distance r of a query, then some substring is within floor(r / substring_count) of it
+struct mih_index {
+    unsigned long substring_count = 0;
+    std::vector<unsigned long> substring_begin;
+    std::vector<std::unordered_map<uint64_t, std::vector<unsigned long>>> tables;
+};
+
+//Builds the index once over the belief set
+//A substring count of 0 picks one based on the belief set size
+mih_index build_mih_index(
+        const packed_states& beliefs, unsigned long substring_count = 0) noexcept;
+
+//Minimum distance between a single state and the indexed beliefs, probing the tables at increasing radii
+//Stops once the minimum reaches lower_bound, and any result above bound is only known to be above it
+unsigned long mih_min_distance(const mih_index& index, const packed_states& beliefs,
+        const uint64_t* state, const unsigned long lower_bound = 0,
+        const unsigned long bound = ULONG_MAX) noexcept;
+
+//Index-backed equivalent of collect_min_distances
+min_collector mih_collect_min_distances(const mih_index& index, const packed_states& formula,
+        const packed_states& beliefs, const unsigned long lower_bound = 0) noexcept;
+
+#endif
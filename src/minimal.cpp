@@ -0,0 +1,296 @@
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <omp.h>
+#include <vector>
+
+#include "minimal.h"
+#include "packed.h"
+
+//Writes the difference between formula row i and belief row j into output
+static inline void pair_difference(const packed_states& formula, const unsigned long i,
+        const packed_states& beliefs, const unsigned long j, uint64_t* output) noexcept {
+    const uint64_t* value = formula.row(i);
+    const uint64_t* belief = beliefs.row(j);
+    for (unsigned long k = 0; k < formula.word_count; ++k) {
+        output[k] = value[k] ^ belief[k];
+        if (formula.is_cubes()) {
+            output[k] &= formula.care_row(i)[k];
+        }
+        if (beliefs.is_cubes()) {
+            output[k] &= beliefs.care_row(j)[k];
+        }
+    }
+}
+
+//Determines if every bit set in first is also set in second
+static inline bool is_subset(
+        const uint64_t* first, const uint64_t* second, const unsigned long word_count) noexcept {
+    for (unsigned long k = 0; k < word_count; ++k) {
+        if (first[k] & ~second[k]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static inline bool row_less(
+        const uint64_t* first, const uint64_t* second, const unsigned long word_count) noexcept {
+    return std::lexicographical_compare(first, first + word_count, second, second + word_count);
+}
+
+//Reduces a flat list of rows to its set-inclusion minimal members, sorted lexicographically
+//Rows are deduplicated and visited in increasing popcount order, so a row can only be covered by a row
+//already accepted, and rows with the same popcount never cover each other
+//The rows of each popcount are tested against the accepted rows in parallel when parallel is set
+static std::vector<uint64_t> minimal_filter(const std::vector<uint64_t>& rows,
+        const unsigned long word_count, const bool parallel) noexcept {
+    if (rows.empty()) {
+        return {};
+    }
+    const unsigned long row_count = rows.size() / word_count;
+    const auto row = [&](const unsigned long i) { return rows.data() + i * word_count; };
+
+    std::vector<unsigned long> popcounts(row_count);
+    for (unsigned long i = 0; i < row_count; ++i) {
+        unsigned long count = 0;
+        for (unsigned long k = 0; k < word_count; ++k) {
+            count += __builtin_popcountll(row(i)[k]);
+        }
+        popcounts[i] = count;
+    }
+
+    std::vector<unsigned long> order(row_count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](const auto a, const auto b) {
+        if (popcounts[a] != popcounts[b]) {
+            return popcounts[a] < popcounts[b];
+        }
+        return row_less(row(a), row(b), word_count);
+    });
+    order.erase(std::unique(order.begin(), order.end(),
+                        [&](const auto a, const auto b) {
+                            return std::equal(row(a), row(a) + word_count, row(b));
+                        }),
+            order.end());
+
+    std::vector<uint64_t> accepted;
+    std::vector<char> keep;
+
+    for (unsigned long begin = 0; begin < order.size();) {
+        unsigned long end = begin;
+        while (end < order.size() && popcounts[order[end]] == popcounts[order[begin]]) {
+            ++end;
+        }
+
+        const unsigned long accepted_count = accepted.size() / word_count;
+        keep.assign(end - begin, 1);
+
+#pragma omp parallel for if(parallel) schedule(dynamic, 64)
+        for (unsigned long i = begin; i < end; ++i) {
+            for (unsigned long a = 0; a < accepted_count; ++a) {
+                if (is_subset(accepted.data() + a * word_count, row(order[i]), word_count)) {
+                    keep[i - begin] = 0;
+                    break;
+                }
+            }
+        }
+
+        for (unsigned long i = begin; i < end; ++i) {
+            if (keep[i - begin]) {
+                accepted.insert(accepted.end(), row(order[i]), row(order[i]) + word_count);
+            }
+        }
+        begin = end;
+    }
+
+    //Sort the survivors lexicographically so they can be binary searched
+    const unsigned long accepted_count = accepted.size() / word_count;
+    std::vector<unsigned long> sorted(accepted_count);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::sort(sorted.begin(), sorted.end(), [&](const auto a, const auto b) {
+        return row_less(accepted.data() + a * word_count, accepted.data() + b * word_count,
+                word_count);
+    });
+
+    std::vector<uint64_t> output;
+    output.reserve(accepted.size());
+    for (const auto i : sorted) {
+        output.insert(output.end(), accepted.data() + i * word_count,
+                accepted.data() + (i + 1) * word_count);
+    }
+    return output;
+}
+
+//Each formula row first filters its own differences, since a row that is not minimal among the
+//differences of one formula row cannot be minimal overall, which keeps the global filter small
+packed_states minimal_differences(
+        const packed_states& formula, const packed_states& beliefs) noexcept {
+    const unsigned long word_count = formula.word_count;
+
+    std::vector<uint64_t> candidates;
+
+#pragma omp parallel
+    {
+        std::vector<uint64_t> local_candidates;
+        std::vector<uint64_t> row_differences(beliefs.size * word_count);
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            for (unsigned long j = 0; j < beliefs.size; ++j) {
+                pair_difference(formula, i, beliefs, j, row_differences.data() + j * word_count);
+            }
+            const auto row_minimal = minimal_filter(row_differences, word_count, false);
+            local_candidates.insert(
+                    local_candidates.end(), row_minimal.cbegin(), row_minimal.cend());
+        }
+
+#pragma omp critical(minimal_candidates)
+        candidates.insert(candidates.end(), local_candidates.cbegin(), local_candidates.cend());
+    }
+
+    packed_states output;
+    output.state_length = formula.state_length;
+    output.word_count = word_count;
+    output.words = minimal_filter(candidates, word_count, true);
+    output.size = output.words.size() / std::max(1ul, word_count);
+
+    return output;
+}
+
+bool contains_difference(const packed_states& differences, const uint64_t* row) noexcept {
+    const unsigned long word_count = differences.word_count;
+
+    unsigned long low = 0;
+    unsigned long high = differences.size;
+    while (low < high) {
+        const unsigned long middle = low + (high - low) / 2;
+        if (row_less(differences.row(middle), row, word_count)) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < differences.size
+            && std::equal(row, row + word_count, differences.row(low));
+}
+
+packed_states satoh_revision(const packed_states& formula, const packed_states& beliefs) noexcept {
+    const unsigned long word_count = formula.word_count;
+    const auto differences = minimal_differences(formula, beliefs);
+
+    packed_states output;
+    output.state_length = formula.state_length;
+    output.word_count = word_count;
+
+#pragma omp parallel
+    {
+        std::vector<uint64_t> local_words;
+        std::vector<uint64_t> local_care;
+        std::vector<uint64_t> difference(word_count);
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            const uint64_t* value = formula.row(i);
+
+            for (unsigned long j = 0; j < beliefs.size; ++j) {
+                pair_difference(formula, i, beliefs, j, difference.data());
+                if (!contains_difference(differences, difference.data())) {
+                    continue;
+                }
+
+                const uint64_t* belief = beliefs.row(j);
+                for (unsigned long k = 0; k < word_count; ++k) {
+                    const uint64_t care = (formula.is_cubes()) ? formula.care_row(i)[k] : ~0ull;
+                    local_words.push_back((value[k] & care) | (belief[k] & ~care));
+                    if (beliefs.is_cubes()) {
+                        local_care.push_back(care | beliefs.care_row(j)[k]);
+                    }
+                }
+            }
+        }
+
+#pragma omp critical(satoh_revision)
+        {
+            output.words.insert(output.words.end(), local_words.cbegin(), local_words.cend());
+            output.care.insert(output.care.end(), local_care.cbegin(), local_care.cend());
+        }
+    }
+
+    output.size = output.words.size() / std::max(1ul, word_count);
+
+    return output;
+}
+
+packed_states weber_revision(const packed_states& formula, const packed_states& beliefs) noexcept {
+    const unsigned long word_count = formula.word_count;
+    const auto differences = minimal_differences(formula, beliefs);
+
+    //Fold the minimal differences into the single mask of variables that are allowed to change
+    std::vector<uint64_t> changeable(word_count, 0);
+    for (unsigned long i = 0; i < differences.size; ++i) {
+        for (unsigned long k = 0; k < word_count; ++k) {
+            changeable[k] |= differences.row(i)[k];
+        }
+    }
+
+    //Bits past the state length must stay out of the care masks
+    std::vector<uint64_t> valid(word_count, ~0ull);
+    if (formula.state_length % 64) {
+        valid.back() = (1ull << (formula.state_length % 64)) - 1;
+    }
+
+    packed_states output;
+    output.state_length = formula.state_length;
+    output.word_count = word_count;
+
+#pragma omp parallel
+    {
+        std::vector<uint64_t> local_words;
+        std::vector<uint64_t> local_care;
+
+#pragma omp for schedule(dynamic) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            const uint64_t* value = formula.row(i);
+
+            for (unsigned long j = 0; j < beliefs.size; ++j) {
+                const uint64_t* belief = beliefs.row(j);
+
+                bool agrees = true;
+                for (unsigned long k = 0; k < word_count && agrees; ++k) {
+                    uint64_t fixed = ~changeable[k];
+                    if (formula.is_cubes()) {
+                        fixed &= formula.care_row(i)[k];
+                    }
+                    if (beliefs.is_cubes()) {
+                        fixed &= beliefs.care_row(j)[k];
+                    }
+                    agrees = !((value[k] ^ belief[k]) & fixed);
+                }
+                if (!agrees) {
+                    continue;
+                }
+
+                //Outside the cube, copy the belief wherever it fixes a variable that may not change
+                for (unsigned long k = 0; k < word_count; ++k) {
+                    const uint64_t care = (formula.is_cubes()) ? formula.care_row(i)[k] : ~0ull;
+                    const uint64_t belief_care
+                            = ((beliefs.is_cubes()) ? beliefs.care_row(j)[k] : ~0ull)
+                            & ~changeable[k] & ~care;
+                    local_words.push_back((value[k] & care) | (belief[k] & belief_care));
+                    local_care.push_back((care | belief_care) & valid[k]);
+                }
+            }
+        }
+
+#pragma omp critical(weber_revision)
+        {
+            output.words.insert(output.words.end(), local_words.cbegin(), local_words.cend());
+            output.care.insert(output.care.end(), local_care.cbegin(), local_care.cend());
+        }
+    }
+
+    output.size = output.words.size() / std::max(1ul, word_count);
+
+    return output;
+}
@@ -0,0 +1,32 @@
+#ifndef MINIMAL_H
+#define MINIMAL_H
+
+#include <cstdint>
+#include <vector>
+
+#include "packed.h"
+
+//Model-based revision operators that compare symmetric differences by set inclusion rather than by size
+//Differences are packed rows with a bit set for every variable that changed
+//The formula is usually the solver's cubes, whose closest completion to a belief copies the belief on every
+//don't care bit, so each (cube, belief) pair only contributes the difference on the bits the cube fixes
+//Beliefs may be cubes as well, in which case only the bits both sides fix can differ
+
+//Finds the set-inclusion minimal differences between the formula and the beliefs
+//The result is sorted lexicographically by word, with no duplicates
+packed_states minimal_differences(
+        const packed_states& formula, const packed_states& beliefs) noexcept;
+
+//Determines if a row is one of the differences, which must be sorted the way minimal_differences sorts them
+bool contains_difference(const packed_states& differences, const uint64_t* row) noexcept;
+
+//Satoh's operator: the formula models whose difference from some belief is set-inclusion minimal
+//Each (cube, belief) pair at a minimal difference is completed from the belief, as complete_from_beliefs does
+packed_states satoh_revision(const packed_states& formula, const packed_states& beliefs) noexcept;
+
+//Weber's operator: the formula models that agree with some belief on every variable outside the union of the
+//minimal differences
+//The result is always cubes, since variables in the union that a formula cube leaves free can take either value
+packed_states weber_revision(const packed_states& formula, const packed_states& beliefs) noexcept;
+
+#endif
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "packed.h"
+
+//Packs the bool vectors into 64-bit words, with variable i stored in bit (i % 64) of word (i / 64)
+packed_states pack_states(const std::vector<std::vector<bool>>& states) noexcept {
+    packed_states output;
+
+    if (states.empty()) {
+        return output;
+    }
+
+    output.state_length = states.front().size();
+    output.word_count = words_for_length(output.state_length);
+    output.size = states.size();
+    output.words.assign(output.size * output.word_count, 0);
+
+#pragma omp parallel for schedule(static)
+    for (unsigned long i = 0; i < states.size(); ++i) {
+        assert(states[i].size() == output.state_length);
+
+        uint64_t* row = output.row(i);
+        for (unsigned long j = 0; j < output.state_length; ++j) {
+            row[j / 64] |= static_cast<uint64_t>(states[i][j]) << (j % 64);
+        }
+    }
+
+    return output;
+}
+
+packed_states pack_cubes(const std::vector<std::vector<int32_t>>& cubes,
+        const unsigned long state_length) noexcept {
+    packed_states output;
+
+    output.state_length = state_length;
+    output.word_count = words_for_length(state_length);
+    output.size = cubes.size();
+    output.words.assign(output.size * output.word_count, 0);
+    output.care.assign(output.size * output.word_count, 0);
+
+#pragma omp parallel for schedule(static)
+    for (unsigned long i = 0; i < cubes.size(); ++i) {
+        uint64_t* row = output.row(i);
+        uint64_t* care = output.care.data() + i * output.word_count;
+
+        for (const auto term : cubes[i]) {
+            const unsigned long variable = std::abs(term) - 1;
+            assert(variable < state_length);
+
+            care[variable / 64] |= 1ull << (variable % 64);
+            row[variable / 64] |= static_cast<uint64_t>(term > 0) << (variable % 64);
+        }
+    }
+
+    return output;
+}
+
+//Rows are ordered by their value words, then by their care words
+packed_states unique_rows(const packed_states& states) noexcept {
+    const unsigned long word_count = states.word_count;
+
+    const auto row_less = [&](const unsigned long a, const unsigned long b) {
+        if (!std::equal(states.row(a), states.row(a) + word_count, states.row(b))) {
+            return std::lexicographical_compare(states.row(a), states.row(a) + word_count,
+                    states.row(b), states.row(b) + word_count);
+        }
+        return states.is_cubes()
+                && std::lexicographical_compare(states.care_row(a), states.care_row(a) + word_count,
+                        states.care_row(b), states.care_row(b) + word_count);
+    };
+    const auto row_equal = [&](const unsigned long a, const unsigned long b) {
+        return !row_less(a, b) && !row_less(b, a);
+    };
+
+    std::vector<unsigned long> order(states.size);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), row_less);
+    order.erase(std::unique(order.begin(), order.end(), row_equal), order.end());
+
+    packed_states output;
+    output.state_length = states.state_length;
+    output.word_count = word_count;
+    output.size = order.size();
+    output.words.reserve(order.size() * word_count);
+    if (states.is_cubes()) {
+        output.care.reserve(order.size() * word_count);
+    }
+    for (const auto i : order) {
+        output.words.insert(output.words.end(), states.row(i), states.row(i) + word_count);
+        if (states.is_cubes()) {
+            output.care.insert(output.care.end(), states.care_row(i), states.care_row(i) + word_count);
+        }
+    }
+
+    return output;
+}
+
+//Disjoint sharp: each remaining cube that overlaps the next input cube is split on the bits only the input
+//cube fixes, keeping the pieces that disagree with it, so the output cubes never overlap
+packed_states complement_cubes(const packed_states& cubes) noexcept {
+    const unsigned long word_count = cubes.word_count;
+
+    //Start from the single cube that covers every state
+    std::vector<uint64_t> values(word_count, 0);
+    std::vector<uint64_t> cares(word_count, 0);
+
+    std::vector<uint64_t> next_values;
+    std::vector<uint64_t> next_cares;
+
+    for (unsigned long c = 0; c < cubes.size && !values.empty(); ++c) {
+        const uint64_t* cube = cubes.row(c);
+        const uint64_t* cube_care = cubes.care_row(c);
+
+        next_values.clear();
+        next_cares.clear();
+
+        for (unsigned long r = 0; r < values.size() / word_count; ++r) {
+            std::vector<uint64_t> value(values.cbegin() + r * word_count,
+                    values.cbegin() + (r + 1) * word_count);
+            std::vector<uint64_t> care(cares.cbegin() + r * word_count,
+                    cares.cbegin() + (r + 1) * word_count);
+
+            bool disjoint = false;
+            for (unsigned long k = 0; k < word_count && !disjoint; ++k) {
+                disjoint = (value[k] ^ cube[k]) & care[k] & cube_care[k];
+            }
+            if (disjoint) {
+                next_values.insert(next_values.end(), value.cbegin(), value.cend());
+                next_cares.insert(next_cares.end(), care.cbegin(), care.cend());
+                continue;
+            }
+
+            //Peel off the states that disagree with the cube on each bit, then fix that bit to agree
+            for (unsigned long k = 0; k < word_count; ++k) {
+                for (uint64_t split = cube_care[k] & ~care[k]; split; split &= split - 1) {
+                    const uint64_t bit = split & -split;
+
+                    care[k] |= bit;
+                    value[k] = (value[k] & ~bit) | (~cube[k] & bit);
+                    next_values.insert(next_values.end(), value.cbegin(), value.cend());
+                    next_cares.insert(next_cares.end(), care.cbegin(), care.cend());
+
+                    value[k] ^= bit;
+                }
+            }
+            //What is left lies inside the cube, so it is dropped
+        }
+
+        values.swap(next_values);
+        cares.swap(next_cares);
+    }
+
+    packed_states output;
+    output.state_length = cubes.state_length;
+    output.word_count = word_count;
+    output.size = values.size() / std::max(1ul, word_count);
+    output.words = std::move(values);
+    output.care = std::move(cares);
+
+    return output;
+}
+
+std::vector<bool> unpack_state(const packed_states& states, const unsigned long index) noexcept {
+    std::vector<bool> output{states.state_length, false, std::allocator<bool>()};
+
+    const uint64_t* row = states.row(index);
+    for (unsigned long j = 0; j < states.state_length; ++j) {
+        output[j] = (row[j / 64] >> (j % 64)) & 1;
+    }
+
+    return output;
+}
+
+std::vector<int32_t> unpack_cube(const packed_states& cubes, const unsigned long index) noexcept {
+    std::vector<int32_t> output;
+
+    const uint64_t* row = cubes.row(index);
+    const uint64_t* care = cubes.care_row(index);
+    for (unsigned long j = 0; j < cubes.state_length; ++j) {
+        if ((care[j / 64] >> (j % 64)) & 1) {
+            const int32_t variable = j + 1;
+            output.push_back(((row[j / 64] >> (j % 64)) & 1) ? variable : -variable);
+        }
+    }
+
+    return output;
+}
+
+packed_cnf pack_cnf(const std::vector<std::vector<int32_t>>& clause_list,
+        const unsigned long state_length) noexcept {
+    packed_cnf output;
+
+    output.word_count = words_for_length(state_length);
+    output.clause_count = clause_list.size();
+    output.positive.assign(output.clause_count * output.word_count, 0);
+    output.negative.assign(output.clause_count * output.word_count, 0);
+
+    for (unsigned long i = 0; i < clause_list.size(); ++i) {
+        for (const auto term : clause_list[i]) {
+            const unsigned long variable = std::abs(term) - 1;
+            assert(variable < state_length);
+
+            auto& masks = (term > 0) ? output.positive : output.negative;
+            masks[i * output.word_count + variable / 64] |= 1ull << (variable % 64);
+        }
+    }
+
+    return output;
+}
@@ -0,0 +1,87 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <cstdint>
+#include <vector>
+
+//Row-major matrix of bit-packed states
+//Every row is padded out to a whole number of 64-bit words, with the padding bits left as zero
+//Rows can also be cubes, where a second matrix of care masks marks which bits the row actually fixes
+//Bits outside a cube's care mask are kept at zero in its value row
+struct packed_states {
+    unsigned long state_length = 0;
+    unsigned long word_count = 0;
+    unsigned long size = 0;
+    std::vector<uint64_t> words;
+    std::vector<uint64_t> care;
+
+    const uint64_t* row(const unsigned long index) const noexcept {
+        return words.data() + index * word_count;
+    }
+    uint64_t* row(const unsigned long index) noexcept {
+        return words.data() + index * word_count;
+    }
+    const uint64_t* care_row(const unsigned long index) const noexcept {
+        return care.data() + index * word_count;
+    }
+    bool is_cubes() const noexcept {
+        return !care.empty();
+    }
+};
+
+//CNF formula compiled into a pair of literal masks per clause, for checking packed states directly
+//A state satisfies a clause if it has a bit set in the positive mask, or a bit clear in the negative mask
+struct packed_cnf {
+    unsigned long word_count = 0;
+    unsigned long clause_count = 0;
+    std::vector<uint64_t> positive;
+    std::vector<uint64_t> negative;
+};
+
+//Number of 64-bit words needed to hold a state of the given length
+constexpr unsigned long words_for_length(const unsigned long state_length) noexcept {
+    return (state_length + 63) / 64;
+}
+
+//Packs a list of equal length bool vectors into a single contiguous word matrix
+packed_states pack_states(const std::vector<std::vector<bool>>& states) noexcept;
+
+//Packs DIMACS style cubes, where each cube lists only the variables it fixes
+packed_states pack_cubes(const std::vector<std::vector<int32_t>>& cubes,
+        const unsigned long state_length) noexcept;
+
+//Sorts the rows and drops any duplicates, where cubes only match if they fix the same bits
+packed_states unique_rows(const packed_states& states) noexcept;
+
+//Computes the cubes covering every state that none of the input cubes cover, without going through CNF
+//The output cubes are disjoint, and there are none if the input cubes cover every state
+packed_states complement_cubes(const packed_states& cubes) noexcept;
+
+//Converts a single packed row back into its bool vector form
+std::vector<bool> unpack_state(const packed_states& states, const unsigned long index) noexcept;
+
+//Converts a single packed cube back into DIMACS style terms, listing only the variables it fixes
+std::vector<int32_t> unpack_cube(const packed_states& cubes, const unsigned long index) noexcept;
+
+//Compiles a clause list into literal masks over states of the given length
+packed_cnf pack_cnf(const std::vector<std::vector<int32_t>>& clause_list,
+        const unsigned long state_length) noexcept;
+
+//Determines if a packed state satisfies every clause of the formula
+inline bool satisfies(const packed_cnf& formula, const uint64_t* state) noexcept {
+    for (unsigned long i = 0; i < formula.clause_count; ++i) {
+        const uint64_t* positive = formula.positive.data() + i * formula.word_count;
+        const uint64_t* negative = formula.negative.data() + i * formula.word_count;
+
+        uint64_t satisfied = 0;
+        for (unsigned long j = 0; j < formula.word_count; ++j) {
+            satisfied |= (state[j] & positive[j]) | (~state[j] & negative[j]);
+        }
+        if (!satisfied) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <iterator>
+#include <omp.h>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+#include "pivot.h"
+
+//Pivot distances for a query are kept on the stack, so the pivot count is capped
+static constexpr unsigned long max_pivot_count = 64;
+
+//Gap between two distances, which the triangle inequality makes a lower bound
+static inline unsigned long distance_gap(const unsigned long first, const unsigned long second) noexcept {
+    return (first > second) ? first - second : second - first;
+}
+
+pivot_index build_pivot_index(const packed_states& beliefs, unsigned long pivot_count) noexcept {
+    assert(!beliefs.is_cubes());
+
+    pivot_index index;
+
+    if (beliefs.size == 0) {
+        return index;
+    }
+
+    const unsigned long word_count = beliefs.word_count;
+    const unsigned long state_length = beliefs.state_length;
+    pivot_count = std::clamp(pivot_count, 1ul, std::min(beliefs.size, max_pivot_count));
+
+    //Each new pivot is the belief furthest from every pivot chosen so far
+    std::vector<unsigned long> chosen{0};
+    std::vector<unsigned long> nearest(beliefs.size, ULONG_MAX);
+    while (true) {
+        const uint64_t* pivot = beliefs.row(chosen.back());
+
+#pragma omp parallel for schedule(static)
+        for (unsigned long i = 0; i < beliefs.size; ++i) {
+            nearest[i] = std::min(
+                    nearest[i], bounded_distance(beliefs.row(i), pivot, word_count, ULONG_MAX));
+        }
+
+        if (chosen.size() == pivot_count) {
+            break;
+        }
+        const auto furthest = std::max_element(nearest.cbegin(), nearest.cend());
+        //Every belief is already a pivot, so more pivots would add nothing
+        if (*furthest == 0) {
+            break;
+        }
+        chosen.push_back(std::distance(nearest.cbegin(), furthest));
+    }
+    index.pivot_count = chosen.size();
+
+    //Counting sort by distance to the first pivot, which never exceeds the state length
+    std::vector<unsigned long> first_distance(beliefs.size);
+#pragma omp parallel for schedule(static)
+    for (unsigned long i = 0; i < beliefs.size; ++i) {
+        first_distance[i]
+                = bounded_distance(beliefs.row(i), beliefs.row(chosen[0]), word_count, ULONG_MAX);
+    }
+
+    index.ring_begin.assign(state_length + 2, 0);
+    for (const auto dist : first_distance) {
+        ++index.ring_begin[dist + 1];
+    }
+    for (unsigned long d = 1; d < index.ring_begin.size(); ++d) {
+        index.ring_begin[d] += index.ring_begin[d - 1];
+    }
+
+    index.order.resize(beliefs.size);
+    std::vector<unsigned long> position(beliefs.size);
+    {
+        std::vector<unsigned long> next(index.ring_begin.cbegin(), index.ring_begin.cend() - 1);
+        for (unsigned long i = 0; i < beliefs.size; ++i) {
+            const unsigned long s = next[first_distance[i]]++;
+            index.order[s] = i;
+            position[i] = s;
+        }
+    }
+
+    index.rows.state_length = state_length;
+    index.rows.word_count = word_count;
+    index.rows.size = beliefs.size;
+    index.rows.words.resize(beliefs.words.size());
+    for (const auto pivot : chosen) {
+        index.pivots.push_back(position[pivot]);
+    }
+
+    index.pivot_distances.resize(beliefs.size * index.pivot_count);
+
+#pragma omp parallel for schedule(static)
+    for (unsigned long s = 0; s < beliefs.size; ++s) {
+        const uint64_t* row = beliefs.row(index.order[s]);
+        std::copy(row, row + word_count, index.rows.row(s));
+
+        for (unsigned long k = 0; k < index.pivot_count; ++k) {
+            index.pivot_distances[s * index.pivot_count + k]
+                    = bounded_distance(row, beliefs.row(chosen[k]), word_count, ULONG_MAX);
+        }
+    }
+
+    return index;
+}
+
+//The pivots are scored first, which seeds the minimum with real distances
+//Rings are then visited at gaps of 0, 1, 2, ... from the state's distance to the first pivot, on both sides,
+//until the gap itself is past the cap, while every other pivot's gap can still rule out single beliefs
+unsigned long pivot_min_distance(const pivot_index& index, const uint64_t* state,
+        const unsigned long lower_bound, const unsigned long bound, unsigned long& compared) noexcept {
+    const packed_states& rows = index.rows;
+    const unsigned long word_count = rows.word_count;
+    const unsigned long pivot_count = index.pivot_count;
+    const unsigned long ring_count = index.ring_begin.size() - 1;
+
+    unsigned long min_dist = ULONG_MAX;
+    unsigned long query_distance[max_pivot_count];
+    for (unsigned long k = 0; k < pivot_count; ++k) {
+        query_distance[k]
+                = bounded_distance(state, rows.row(index.pivots[k]), word_count, ULONG_MAX);
+        min_dist = std::min(min_dist, query_distance[k]);
+    }
+    compared += pivot_count;
+
+    if (min_dist <= lower_bound) {
+        return min_dist;
+    }
+
+    const unsigned long center = query_distance[0];
+
+    for (unsigned long gap = 0; gap <= std::min(min_dist - 1, bound); ++gap) {
+        if (gap > center && center + gap >= ring_count) {
+            break;
+        }
+
+        for (unsigned long side = 0; side < 2; ++side) {
+            unsigned long ring;
+            if (side == 0) {
+                if (gap > center) {
+                    continue;
+                }
+                ring = center - gap;
+            } else {
+                if (gap == 0 || center + gap >= ring_count) {
+                    continue;
+                }
+                ring = center + gap;
+            }
+
+            for (unsigned long s = index.ring_begin[ring]; s < index.ring_begin[ring + 1]; ++s) {
+                const unsigned long cap = std::min(min_dist - 1, bound);
+                if (gap > cap) {
+                    break;
+                }
+
+                const unsigned long* belief_distance
+                        = index.pivot_distances.data() + s * pivot_count;
+                bool pruned = false;
+                for (unsigned long k = 1; k < pivot_count && !pruned; ++k) {
+                    pruned = (distance_gap(query_distance[k], belief_distance[k]) > cap);
+                }
+                if (pruned) {
+                    continue;
+                }
+
+                ++compared;
+                const unsigned long dist = bounded_distance(state, rows.row(s), word_count, cap);
+                if (dist <= cap) {
+                    min_dist = dist;
+                    if (min_dist <= lower_bound) {
+                        return min_dist;
+                    }
+                }
+            }
+        }
+    }
+
+    return min_dist;
+}
+
+min_collector pivot_collect_min_distances(const pivot_index& index, const packed_states& formula,
+        const unsigned long lower_bound, double* pruned_fraction) noexcept {
+    assert(!formula.is_cubes());
+    assert(formula.word_count == index.rows.word_count);
+
+    min_collector output;
+    std::atomic<unsigned long> shared_bound{ULONG_MAX};
+    unsigned long compared = 0;
+
+#pragma omp parallel reduction(+ : compared)
+    {
+        min_collector local;
+
+#pragma omp for schedule(dynamic, 64) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            const unsigned long dist = pivot_min_distance(index, formula.row(i), lower_bound,
+                    shared_bound.load(std::memory_order_relaxed), compared);
+            local.add(dist, i);
+
+            lower_shared_bound(shared_bound, dist);
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    if (pruned_fraction) {
+        const double pairs = static_cast<double>(formula.size) * index.rows.size;
+        *pruned_fraction = (pairs > 0) ? std::max(0.0, 1.0 - compared / pairs) : 0.0;
+    }
+
+    return output;
+}
@@ -0,0 +1,44 @@
+#ifndef PIVOT_H
+#define PIVOT_H
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+
+//Triangle inequality pruning over a packed belief set, using a few beliefs as pivots
+//Hamming distance is a metric, so |d(x, p) - d(b, p)| is a lower bound on d(x, b) for any pivot p
+//Beliefs are kept sorted by their distance to the first pivot, so a query walks outward from its own distance
+//to that pivot and stops once the gap alone exceeds the best it has found
+struct pivot_index {
+    unsigned long pivot_count = 0;
+    //The pivots, as rows of the belief set
+    std::vector<unsigned long> pivots;
+    //Belief indices sorted by their distance to the first pivot
+    std::vector<unsigned long> order;
+    //Start of the run of beliefs at each distance from the first pivot, with one extra entry at the end
+    std::vector<unsigned long> ring_begin;
+    //Distance from each belief, in sorted order, to every pivot
+    std::vector<unsigned long> pivot_distances;
+    //The beliefs copied into sorted order, so each ring reads its rows contiguously
+    packed_states rows;
+};
+
+//Builds the index once over the belief set, which must hold full states rather than cubes
+//Pivots are picked farthest first, starting from the first belief, so they spread out over the set
+pivot_index build_pivot_index(const packed_states& beliefs, unsigned long pivot_count) noexcept;
+
+//Minimum distance between a single state and the indexed beliefs
+//Stops once the minimum reaches lower_bound, and any result above bound is only known to be above it
+//Adds the number of beliefs whose full distance had to be computed, pivots included, to compared
+unsigned long pivot_min_distance(const pivot_index& index, const uint64_t* state,
+        const unsigned long lower_bound, const unsigned long bound, unsigned long& compared) noexcept;
+
+//Index-backed equivalent of collect_min_distances, where the formula must hold full states
+//If pruned_fraction is given, it is set to the fraction of state and belief pairs that were never compared
+min_collector pivot_collect_min_distances(const pivot_index& index, const packed_states& formula,
+        const unsigned long lower_bound = 0, double* pruned_fraction = nullptr) noexcept;
+
+#endif
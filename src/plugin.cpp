@@ -0,0 +1,84 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <dlfcn.h>
+#include <iostream>
+#include <vector>
+
+#include "packed.h"
+#include "plugin.h"
+#include "preorder_plugin.h"
+
+//Number of formula states handed to the plugin in each call
+static constexpr unsigned long plugin_block_size = 1024;
+
+//The plugin stays loaded until the process exits, so the handle is never closed
+static belief_preorder_score_fn plugin_score = nullptr;
+
+bool load_preorder_plugin(const char* path) noexcept {
+    void* handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        std::cerr << "Unable to load pre-order plugin: " << dlerror() << "\n";
+        return false;
+    }
+
+    const auto version = reinterpret_cast<belief_preorder_version_fn>(
+            dlsym(handle, "belief_preorder_version"));
+    const auto score
+            = reinterpret_cast<belief_preorder_score_fn>(dlsym(handle, "belief_preorder_score"));
+    if (!version || !score) {
+        std::cerr << "Pre-order plugin " << path
+                  << " must export belief_preorder_version and belief_preorder_score\n";
+        dlclose(handle);
+        return false;
+    }
+    if (version() != BELIEF_PREORDER_ABI_VERSION) {
+        std::cerr << "Pre-order plugin " << path << " was built for ABI version " << version()
+                  << ", expected " << BELIEF_PREORDER_ABI_VERSION << "\n";
+        dlclose(handle);
+        return false;
+    }
+
+    plugin_score = score;
+    return true;
+}
+
+void use_preorder_scorer(belief_preorder_score_fn score) noexcept {
+    plugin_score = score;
+}
+
+bool preorder_plugin_loaded() noexcept {
+    return plugin_score != nullptr;
+}
+
+std::vector<unsigned long> plugin_distances(
+        const packed_states& states, const packed_states& beliefs) noexcept {
+    assert(plugin_score);
+    assert(!states.is_cubes() && !beliefs.is_cubes());
+    assert(states.word_count == beliefs.word_count);
+
+    std::vector<uint64_t> scores(states.size);
+
+#pragma omp parallel for schedule(dynamic)
+    for (unsigned long begin = 0; begin < states.size; begin += plugin_block_size) {
+        const unsigned long count = std::min(plugin_block_size, states.size - begin);
+        plugin_score(states.row(begin), count, beliefs.words.data(), beliefs.size, states.state_length,
+                states.word_count, scores.data() + begin);
+    }
+
+    return {scores.cbegin(), scores.cend()};
+}
+
+unsigned long plugin_preorder(
+        const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set) {
+    assert(plugin_score);
+
+    const auto state_bits = pack_states({state});
+    const auto belief_bits = pack_states(belief_set);
+
+    uint64_t score = 0;
+    plugin_score(state_bits.words.data(), 1, belief_bits.words.data(), belief_bits.size,
+            state_bits.state_length, state_bits.word_count, &score);
+
+    return score;
+}
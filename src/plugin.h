@@ -0,0 +1,29 @@
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <vector>
+
+#include "packed.h"
+#include "preorder_plugin.h"
+
+//Loads a pre-order plugin, checking its ABI version before any revision can use it
+//Returns false, after printing the reason, if the library or its symbols can't be loaded
+bool load_preorder_plugin(const char* path) noexcept;
+
+//Uses a block scorer built into the application, which follows the same contract as a plugin's score function
+void use_preorder_scorer(belief_preorder_score_fn score) noexcept;
+
+//Determines if a pre-order plugin has been loaded
+bool preorder_plugin_loaded() noexcept;
+
+//Scores every packed state against the packed beliefs with the loaded plugin, a block of states per call
+std::vector<unsigned long> plugin_distances(
+        const packed_states& states, const packed_states& beliefs) noexcept;
+
+//Scores a single state with the loaded plugin, so it can be assigned to total_preorder
+//The belief set is packed again on every call, so anything that can score a whole block of states at once
+//should call plugin_distances instead
+unsigned long plugin_preorder(
+        const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set);
+
+#endif
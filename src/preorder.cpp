@@ -0,0 +1,60 @@
+#include <vector>
+
+#include "belief.h"
+#include "distance.h"
+#include "packed.h"
+#include "plugin.h"
+#include "preorder.h"
+
+template<typename Preorder>
+std::vector<unsigned long> policy_distances(const std::vector<std::vector<bool>>& states,
+        const std::vector<std::vector<bool>>& belief_set) noexcept {
+    std::vector<unsigned long> distances(states.size());
+
+#pragma omp parallel for schedule(static) if (Preorder::thread_safe)
+    for (unsigned long i = 0; i < states.size(); ++i) {
+        distances[i] = Preorder::score(states[i], belief_set);
+    }
+
+    return distances;
+}
+
+template std::vector<unsigned long> policy_distances<example_preorder_policy>(
+        const std::vector<std::vector<bool>>&, const std::vector<std::vector<bool>>&) noexcept;
+template std::vector<unsigned long> policy_distances<function_preorder>(
+        const std::vector<std::vector<bool>>&, const std::vector<std::vector<bool>>&) noexcept;
+
+preorder_kind active_preorder() noexcept {
+    using preorder_pointer
+            = unsigned long (*)(const std::vector<bool>&, const std::vector<std::vector<bool>>&);
+
+    //Lambdas and other callables have no function pointer target, so they can only be custom
+    const auto target = total_preorder.target<preorder_pointer>();
+    if (!target) {
+        return preorder_kind::CUSTOM;
+    }
+    if (*target == state_difference) {
+        return preorder_kind::HAMMING;
+    }
+    if (*target == example_preorder) {
+        return preorder_kind::EXAMPLE;
+    }
+    if (*target == plugin_preorder && preorder_plugin_loaded()) {
+        return preorder_kind::BLOCK;
+    }
+    return preorder_kind::CUSTOM;
+}
+
+std::vector<unsigned long> preorder_distances(const std::vector<std::vector<bool>>& states,
+        const std::vector<std::vector<bool>>& belief_set) noexcept {
+    switch (active_preorder()) {
+        case preorder_kind::HAMMING:
+            return min_distances(pack_states(states), pack_states(belief_set));
+        case preorder_kind::EXAMPLE:
+            return policy_distances<example_preorder_policy>(states, belief_set);
+        case preorder_kind::BLOCK:
+            return plugin_distances(pack_states(states), pack_states(belief_set));
+        default:
+            return policy_distances<function_preorder>(states, belief_set);
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef PREORDER_H
+#define PREORDER_H
+
+#include <vector>
+
+#include "belief.h"
+
+//Pre-order policies, each a type with a static score function that the scan below inlines into its loop
+//Policies that are safe to call from several threads at once are scored in parallel
+//The Dalal pre-order has no policy, since it always goes to the packed distance engine
+
+//The example pre-order, whose body lives here so the scan can inline it
+//example_preorder in src/belief.cpp forwards to it, for use as total_preorder
+struct example_preorder_policy {
+    static constexpr bool thread_safe = true;
+    static unsigned long score(
+            const std::vector<bool>& state, const std::vector<std::vector<bool>>&) {
+        if (state.size() < 3) {
+            return 2;
+        }
+        if (state[0]) {
+            return 0;
+        } else if (state[1]) {
+            return 1;
+        } else if (state[2]) {
+            return 4;
+        } else {
+            return 7;
+        }
+    }
+};
+
+//Whatever total_preorder holds, called through the std::function one state at a time
+struct function_preorder {
+    static constexpr bool thread_safe = false;
+    static unsigned long score(
+            const std::vector<bool>& state, const std::vector<std::vector<bool>>& belief_set) {
+        return total_preorder(state, belief_set);
+    }
+};
+
+//Scores every state against the whole belief set with the policy's pre-order
+template<typename Preorder>
+std::vector<unsigned long> policy_distances(const std::vector<std::vector<bool>>& states,
+        const std::vector<std::vector<bool>>& belief_set) noexcept;
+
+extern template std::vector<unsigned long> policy_distances<example_preorder_policy>(
+        const std::vector<std::vector<bool>>&, const std::vector<std::vector<bool>>&) noexcept;
+extern template std::vector<unsigned long> policy_distances<function_preorder>(
+        const std::vector<std::vector<bool>>&, const std::vector<std::vector<bool>>&) noexcept;
+
+//Which implementation total_preorder currently resolves to
+enum class preorder_kind {
+    //The Dalal pre-order, which gets the packed distance engine
+    HAMMING,
+    //The shipped example pre-order
+    EXAMPLE,
+    //A plugin or expression that scores packed blocks
+    BLOCK,
+    //Any other function, which can only be called through total_preorder
+    CUSTOM
+};
+
+//Identifies the pre-order total_preorder holds, without calling it
+preorder_kind active_preorder() noexcept;
+
+//Scores every state against the whole belief set, dispatching once to the matching policy or packed scan
+std::vector<unsigned long> preorder_distances(const std::vector<std::vector<bool>>& states,
+        const std::vector<std::vector<bool>>& belief_set) noexcept;
+
+#endif
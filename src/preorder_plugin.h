@@ -0,0 +1,37 @@
+#ifndef PREORDER_PLUGIN_H
+#define PREORDER_PLUGIN_H
+
+/*
+ * C ABI for pre-order plugins loaded with --preorder
+ * A plugin is a shared library exporting the two functions below with C linkage, and can be written in C or C++
+ */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//Bumped whenever the layout or meaning of the arguments changes
+#define BELIEF_PREORDER_ABI_VERSION 1
+
+//Returns the ABI version the plugin was built against, which must match BELIEF_PREORDER_ABI_VERSION
+uint32_t belief_preorder_version(void);
+
+//Scores a block of formula states against the whole belief set, writing one score per state into scores
+//Lower scores are closer, and the revision keeps the formula states with the lowest score
+//States and beliefs are row-major matrices of word_count 64-bit words per row, with variable i stored in
+//bit (i % 64) of word (i / 64), and the padding bits past state_length left as zero
+//This can be called from several threads at once, each with a different block of states
+void belief_preorder_score(const uint64_t* states, uint64_t state_count, const uint64_t* beliefs,
+        uint64_t belief_count, uint64_t state_length, uint64_t word_count, uint64_t* scores);
+
+typedef uint32_t (*belief_preorder_version_fn)(void);
+typedef void (*belief_preorder_score_fn)(const uint64_t*, uint64_t, const uint64_t*, uint64_t, uint64_t,
+        uint64_t, uint64_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PREORDER_PLUGIN_H */
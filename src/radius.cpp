@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iterator>
+#include <omp.h>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "packed.h"
+#include "radius.h"
+
+//Each clause of k distinct variables rules out 2^-k of the remaining assignments
+double estimate_model_count_log2(const std::vector<std::vector<int32_t>>& clause_list,
+        const unsigned long state_length) noexcept {
+    double estimate = state_length;
+
+    for (const auto& clause : clause_list) {
+        std::unordered_set<int32_t> variables;
+        for (const auto term : clause) {
+            variables.emplace(std::abs(term));
+        }
+        estimate += std::log2(1.0 - std::pow(2.0, -static_cast<double>(variables.size())));
+    }
+
+    return estimate;
+}
+
+double ball_cost_log2(const unsigned long belief_count, const unsigned long state_length,
+        const unsigned long radius) noexcept {
+    double ball_size = 0;
+    for (unsigned long r = 0; r <= std::min(radius, state_length); ++r) {
+        ball_size += std::exp(std::lgamma(state_length + 1.0) - std::lgamma(r + 1.0)
+                - std::lgamma(state_length - r + 1.0));
+    }
+    return std::log2(static_cast<double>(belief_count)) + std::log2(ball_size);
+}
+
+//Every belief is expanded in parallel, flipping each combination of radius bits in turn
+//Positions are walked as a sorted index array, so states wider than 64 bits are handled the same way
+std::pair<unsigned long, std::vector<std::vector<bool>>> radius_revision(
+        const packed_states& beliefs, const packed_cnf& formula,
+        const unsigned long max_radius) noexcept {
+    const unsigned long state_length = beliefs.state_length;
+    const unsigned long word_count = beliefs.word_count;
+
+    for (unsigned long radius = 0; radius <= std::min(max_radius, state_length); ++radius) {
+        std::vector<uint64_t> found_words;
+
+#pragma omp parallel
+        {
+            std::vector<uint64_t> local_words;
+            std::vector<uint64_t> candidate(word_count);
+            std::vector<unsigned long> positions(radius);
+
+#pragma omp for schedule(dynamic, 16) nowait
+            for (unsigned long i = 0; i < beliefs.size; ++i) {
+                const uint64_t* belief = beliefs.row(i);
+
+                for (unsigned long j = 0; j < radius; ++j) {
+                    positions[j] = j;
+                }
+                for (;;) {
+                    std::copy(belief, belief + word_count, candidate.begin());
+                    for (const auto p : positions) {
+                        candidate[p / 64] ^= 1ull << (p % 64);
+                    }
+                    if (satisfies(formula, candidate.data())) {
+                        local_words.insert(local_words.end(), candidate.cbegin(), candidate.cend());
+                    }
+
+                    //Advance to the next combination of flipped positions
+                    long k = static_cast<long>(radius) - 1;
+                    while (k >= 0 && positions[k] == state_length - radius + k) {
+                        --k;
+                    }
+                    if (k < 0) {
+                        break;
+                    }
+                    ++positions[k];
+                    for (unsigned long j = k + 1; j < radius; ++j) {
+                        positions[j] = positions[j - 1] + 1;
+                    }
+                }
+            }
+
+#pragma omp critical(radius_found)
+            found_words.insert(found_words.end(), local_words.cbegin(), local_words.cend());
+        }
+
+        if (found_words.empty()) {
+            continue;
+        }
+
+        //Nothing was found at a smaller radius, so every state found here is at exactly this distance
+        packed_states found;
+        found.state_length = state_length;
+        found.word_count = word_count;
+        found.size = found_words.size() / word_count;
+        found.words = std::move(found_words);
+
+        std::vector<std::vector<bool>> output;
+        output.reserve(found.size);
+        for (unsigned long i = 0; i < found.size; ++i) {
+            output.emplace_back(unpack_state(found, i));
+        }
+        std::sort(output.begin(), output.end());
+        output.erase(std::unique(output.begin(), output.end()), output.end());
+
+        return {radius, output};
+    }
+
+    return {max_radius, {}};
+}
@@ -0,0 +1,26 @@
+#ifndef RADIUS_H
+#define RADIUS_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "packed.h"
+
+//Estimates log2 of the number of models of a CNF formula over state_length variables
+//Treats every clause as independent, so it is only good for choosing between engines
+double estimate_model_count_log2(const std::vector<std::vector<int32_t>>& clause_list,
+        const unsigned long state_length) noexcept;
+
+//log2 of the number of states searched when expanding every belief out to the given radius
+double ball_cost_log2(const unsigned long belief_count, const unsigned long state_length,
+        const unsigned long radius) noexcept;
+
+//Searches outward from the beliefs, one Hamming radius at a time, until some state satisfies the formula
+//Returns the revision distance along with every satisfying state at that distance
+//The state list is empty if nothing was found within max_radius
+std::pair<unsigned long, std::vector<std::vector<bool>>> radius_revision(
+        const packed_states& beliefs, const packed_cnf& formula,
+        const unsigned long max_radius) noexcept;
+
+#endif
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include "belief.h"
+#include "sat.h"
+#include "utils.h"
+
+//Builds the tree of unary counters bottom up, merging neighbouring counters pairwise
+//Both directions of each merge are encoded, so every output is fully determined by the inputs
+//That keeps the solver from producing the same formula state more than once under different auxiliary values
+std::vector<int32_t> encode_totalizer(const std::vector<int32_t>& literals, const unsigned long cap,
+        int32_t& next_variable, std::vector<std::vector<int32_t>>& clause_list) noexcept {
+    std::vector<std::vector<int32_t>> counters;
+    counters.reserve(literals.size());
+    for (const auto literal : literals) {
+        counters.push_back({literal});
+    }
+
+    while (counters.size() > 1) {
+        std::vector<std::vector<int32_t>> merged;
+        merged.reserve((counters.size() + 1) / 2);
+
+        for (unsigned long c = 0; c + 1 < counters.size(); c += 2) {
+            const auto& left = counters[c];
+            const auto& right = counters[c + 1];
+            const unsigned long width = std::min(cap, left.size() + right.size());
+
+            std::vector<int32_t> outputs;
+            outputs.reserve(width);
+            for (unsigned long k = 0; k < width; ++k) {
+                outputs.push_back(next_variable++);
+            }
+
+            //i and j count how many inputs are known true on each side, where 0 needs no literal
+            for (unsigned long i = 0; i <= left.size(); ++i) {
+                for (unsigned long j = 0; j <= right.size(); ++j) {
+                    //At least i on the left and j on the right means at least i + j overall
+                    if (i + j >= 1 && i + j <= width) {
+                        std::vector<int32_t> clause;
+                        if (i > 0) {
+                            clause.push_back(-left[i - 1]);
+                        }
+                        if (j > 0) {
+                            clause.push_back(-right[j - 1]);
+                        }
+                        clause.push_back(outputs[i + j - 1]);
+                        clause_list.emplace_back(std::move(clause));
+                    }
+                    //At most i on the left and j on the right means at most i + j overall
+                    if (i + j + 1 <= width) {
+                        std::vector<int32_t> clause;
+                        if (i < left.size()) {
+                            clause.push_back(left[i]);
+                        }
+                        if (j < right.size()) {
+                            clause.push_back(right[j]);
+                        }
+                        clause.push_back(-outputs[i + j]);
+                        clause_list.emplace_back(std::move(clause));
+                    }
+                }
+            }
+            merged.emplace_back(std::move(outputs));
+        }
+        if (counters.size() % 2) {
+            merged.emplace_back(std::move(counters.back()));
+        }
+        counters = std::move(merged);
+    }
+
+    if (counters.empty()) {
+        return {};
+    }
+    if (counters.front().size() > cap) {
+        counters.front().resize(cap);
+    }
+    return counters.front();
+}
+
+//Each d gets a fresh CNF: the formula, a totalizer per belief over the literals that differ from it,
+//and one clause saying some belief's count stays at or below d
+//Walking d upwards keeps every call before the optimum unsatisfiable, which the solver proves without enumerating
+//The first satisfiable call is exactly the optimal layer, so its models are the answer
+//That only holds if every earlier call was proven unsatisfiable, so a failed call stops the search
+bool sat_revision(const std::vector<std::vector<bool>>& beliefs,
+        const std::vector<std::vector<int32_t>>& formula, unsigned long& distance,
+        std::vector<std::vector<bool>>& states) noexcept {
+    const unsigned long belief_length = beliefs.front().size();
+
+    states.clear();
+
+    for (distance = 0; distance <= belief_length; ++distance) {
+        auto clause_list = formula;
+        int32_t next_variable = belief_length + 1;
+
+        //At belief_length every state qualifies, so the formula is all that is left
+        if (distance < belief_length) {
+            std::vector<int32_t> within_distance;
+            within_distance.reserve(beliefs.size());
+
+            for (const auto& belief : beliefs) {
+                std::vector<int32_t> differences;
+                differences.reserve(belief_length);
+                for (unsigned long i = 0; i < belief_length; ++i) {
+                    const int32_t variable = i + 1;
+                    differences.push_back((belief[i]) ? -variable : variable);
+                }
+                const auto counts
+                        = encode_totalizer(differences, distance + 1, next_variable, clause_list);
+                within_distance.push_back(-counts[distance]);
+            }
+            clause_list.emplace_back(std::move(within_distance));
+        }
+
+        std::vector<std::vector<int32_t>> cubes;
+        if (!try_run_allsat(clause_list, cubes)) {
+            return false;
+        }
+
+        report_stream() << "SAT search at distance " << distance << " found " << cubes.size()
+                  << " cubes\n";
+
+        if (cubes.empty()) {
+            continue;
+        }
+
+        //Project away the auxiliary variables, then pad each cube out to full states
+        for (auto& cube : cubes) {
+            std::vector<bool> state{belief_length, false, std::allocator<bool>()};
+            std::vector<unsigned long> free_variables;
+            std::vector<bool> fixed{belief_length, false, std::allocator<bool>()};
+
+            for (const auto term : cube) {
+                const unsigned long variable = std::abs(term) - 1;
+                if (variable < belief_length) {
+                    state[variable] = (term > 0);
+                    fixed[variable] = true;
+                }
+            }
+            for (unsigned long i = 0; i < belief_length; ++i) {
+                if (!fixed[i]) {
+                    free_variables.push_back(i);
+                }
+            }
+            if (free_variables.size() >= 64) {
+                std::cerr << "Optimal layer is too large to expand\n";
+                exit(EXIT_FAILURE);
+            }
+            for (uint64_t mask = 0; mask < (1ull << free_variables.size()); ++mask) {
+                for (unsigned long i = 0; i < free_variables.size(); ++i) {
+                    state[free_variables[i]] = (mask >> i) & 1;
+                }
+                states.push_back(state);
+            }
+        }
+        std::sort(states.begin(), states.end());
+        states.erase(std::unique(states.begin(), states.end()), states.end());
+
+        return true;
+    }
+
+    distance = belief_length;
+    return true;
+}
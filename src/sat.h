@@ -0,0 +1,22 @@
+#ifndef SAT_H
+#define SAT_H
+
+#include <cstdint>
+#include <vector>
+
+//Appends a totalizer over the literals to the clause list, counting up to cap of them
+//Returns the output literals, where output[k] is true exactly when at least k + 1 of the inputs are true
+//New variables are numbered from next_variable, which is advanced past them
+std::vector<int32_t> encode_totalizer(const std::vector<int32_t>& literals, const unsigned long cap,
+        int32_t& next_variable, std::vector<std::vector<int32_t>>& clause_list) noexcept;
+
+//Finds the Dalal revision without enumerating every model of the formula
+//Looks for the smallest d where the formula is satisfiable alongside "within d of some belief",
+//then sets distance to d and states to the models found at that distance
+//The state list is empty if the formula is unsatisfiable
+//Returns false if the solver failed, with distance set to the d it failed at, since nothing past it is optimal
+bool sat_revision(const std::vector<std::vector<bool>>& beliefs,
+        const std::vector<std::vector<int32_t>>& formula, unsigned long& distance,
+        std::vector<std::vector<bool>>& states) noexcept;
+
+#endif
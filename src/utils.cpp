@@ -59,7 +59,17 @@ std::string print_formula_dnf(const std::vector<std::vector<int32_t>>& formula)
         }
     }
     ss << std::endl;
-    std::cout << ss.str();
+    report_stream() << ss.str();
     return ss.str();
 }
 
+static thread_local std::ostream* report_target = nullptr;
+
+std::ostream& report_stream() noexcept {
+    return (report_target) ? *report_target : std::cout;
+}
+
+void redirect_reports(std::ostream* stream) noexcept {
+    report_target = stream;
+}
+
@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <cstdint>
+#include <ostream>
 #include <string>
 
 std::vector<std::vector<bool>> convert_to_bool(const std::vector<std::vector<int32_t>>& state) noexcept;
@@ -10,4 +11,11 @@ std::vector<std::vector<int32_t>> convert_to_num(const std::vector<std::vector<b
 
 std::string print_formula_dnf(const std::vector<std::vector<int32_t>>& formula) noexcept;
 
+//Stream that revision progress and results are reported on, which is std::cout unless the calling thread
+//redirected it, so parallel batch workers can each collect their own report
+std::ostream& report_stream() noexcept;
+
+//Redirects the calling thread's reports to the stream, or back to std::cout with nullptr
+void redirect_reports(std::ostream* stream) noexcept;
+
 #endif
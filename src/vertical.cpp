@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <climits>
+#include <cstdint>
+#include <omp.h>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+#include "vertical.h"
+
+//Largest counter a block can need, which covers any distance that fits in an unsigned long
+static constexpr unsigned long max_counter_bits = 64;
+
+//Number of variables between checks for whether any lane of a block can still beat the bound
+static constexpr unsigned long abandon_interval = 64;
+
+//Bit-sliced counter for one block, where plane k holds bit k of every lane's running distance
+using lane_counter = uint64_t[max_counter_bits][vertical_block_words];
+
+vertical_beliefs build_vertical_beliefs(const packed_states& beliefs) noexcept {
+    assert(!beliefs.is_cubes());
+
+    vertical_beliefs output;
+    output.state_length = beliefs.state_length;
+    output.size = beliefs.size;
+    output.block_count = (beliefs.size + vertical_block_size - 1) / vertical_block_size;
+    while (output.counter_bits < max_counter_bits && (output.state_length >> output.counter_bits)) {
+        ++output.counter_bits;
+    }
+    output.planes.assign(output.block_count * output.state_length * vertical_block_words, 0);
+    output.valid.assign(output.block_count * vertical_block_words, 0);
+
+#pragma omp parallel for schedule(static)
+    for (unsigned long block = 0; block < output.block_count; ++block) {
+        uint64_t* planes
+                = output.planes.data() + block * output.state_length * vertical_block_words;
+        uint64_t* valid = output.valid.data() + block * vertical_block_words;
+
+        const unsigned long first = block * vertical_block_size;
+        const unsigned long last = std::min(first + vertical_block_size, beliefs.size);
+
+        for (unsigned long i = first; i < last; ++i) {
+            const unsigned long lane = i - first;
+            const uint64_t lane_bit = 1ull << (lane % 64);
+            const uint64_t* row = beliefs.row(i);
+
+            valid[lane / 64] |= lane_bit;
+            for (unsigned long v = 0; v < output.state_length; ++v) {
+                if ((row[v / 64] >> (v % 64)) & 1) {
+                    planes[v * vertical_block_words + lane / 64] |= lane_bit;
+                }
+            }
+        }
+    }
+
+    return output;
+}
+
+//Marks the lanes whose count is at most cap, comparing the counter planes from the most significant down
+static void lanes_within(const lane_counter& counter, const unsigned long counter_bits,
+        const unsigned long cap, uint64_t* lanes) noexcept {
+    if (counter_bits < max_counter_bits && (cap >> counter_bits)) {
+        std::fill(lanes, lanes + vertical_block_words, ~0ull);
+        return;
+    }
+
+    uint64_t less[vertical_block_words] = {0};
+    uint64_t equal[vertical_block_words];
+    std::fill(std::begin(equal), std::end(equal), ~0ull);
+
+    for (unsigned long k = counter_bits; k-- > 0;) {
+        const bool cap_bit = (cap >> k) & 1;
+        for (unsigned long w = 0; w < vertical_block_words; ++w) {
+            if (cap_bit) {
+                less[w] |= equal[w] & ~counter[k][w];
+                equal[w] &= counter[k][w];
+            } else {
+                equal[w] &= ~counter[k][w];
+            }
+        }
+    }
+
+    for (unsigned long w = 0; w < vertical_block_words; ++w) {
+        lanes[w] = less[w] | equal[w];
+    }
+}
+
+//Finds the smallest count among the candidate lanes, which must not be empty
+//Each counter bit from the most significant down keeps the candidates with a zero there, if there are any
+static unsigned long lane_minimum(const lane_counter& counter, const unsigned long counter_bits,
+        uint64_t* candidates) noexcept {
+    unsigned long minimum = 0;
+
+    for (unsigned long k = counter_bits; k-- > 0;) {
+        uint64_t zeros[vertical_block_words];
+        uint64_t any = 0;
+        for (unsigned long w = 0; w < vertical_block_words; ++w) {
+            zeros[w] = candidates[w] & ~counter[k][w];
+            any |= zeros[w];
+        }
+        if (any) {
+            std::copy(std::begin(zeros), std::end(zeros), candidates);
+        } else {
+            minimum |= 1ul << k;
+        }
+    }
+
+    return minimum;
+}
+
+//Sums the distance from the state to every lane of a block into the counter, two variables at a time
+//The two differences are folded into the ones plane with a carry-save adder, and only the carry ripples
+//Returns false if the block was abandoned because no lane could come in at or under cap
+static bool block_distances(const vertical_beliefs& beliefs, const unsigned long block,
+        const uint64_t* state, const unsigned long cap, lane_counter& counter) noexcept {
+    const unsigned long state_length = beliefs.state_length;
+    const uint64_t* valid = beliefs.valid_lanes(block);
+
+    for (unsigned long k = 0; k < beliefs.counter_bits; ++k) {
+        std::fill(std::begin(counter[k]), std::end(counter[k]), 0);
+    }
+
+    for (unsigned long v = 0; v < state_length; v += 2) {
+        //A set state bit flips the plane, so every lane ends up holding whether it differs from the state
+        const uint64_t* first = beliefs.plane(block, v);
+        const uint64_t first_flip = -((state[v / 64] >> (v % 64)) & 1);
+
+        const bool paired = (v + 1 < state_length);
+        const uint64_t* second = paired ? beliefs.plane(block, v + 1) : first;
+        const uint64_t second_flip = paired ? -((state[(v + 1) / 64] >> ((v + 1) % 64)) & 1) : 0;
+        const uint64_t second_mask = paired ? ~0ull : 0;
+
+        uint64_t carry[vertical_block_words];
+        uint64_t any = 0;
+        for (unsigned long w = 0; w < vertical_block_words; ++w) {
+            const uint64_t x = first[w] ^ first_flip;
+            const uint64_t y = (second[w] ^ second_flip) & second_mask;
+            const uint64_t partial = counter[0][w] ^ x;
+
+            carry[w] = (counter[0][w] & x) | (partial & y);
+            counter[0][w] = partial ^ y;
+            any |= carry[w];
+        }
+
+        //Distances never exceed state_length, so the carry always dies out before the top counter bit
+        for (unsigned long k = 1; any; ++k) {
+            any = 0;
+            for (unsigned long w = 0; w < vertical_block_words; ++w) {
+                const uint64_t next = counter[k][w] & carry[w];
+                counter[k][w] ^= carry[w];
+                carry[w] = next;
+                any |= next;
+            }
+        }
+
+        if ((v + 2) % abandon_interval == 0 && v + 2 < state_length) {
+            uint64_t lanes[vertical_block_words];
+            lanes_within(counter, beliefs.counter_bits, cap, lanes);
+
+            uint64_t live = 0;
+            for (unsigned long w = 0; w < vertical_block_words; ++w) {
+                live |= lanes[w] & valid[w];
+            }
+            if (!live) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+unsigned long vertical_min_distance(const vertical_beliefs& beliefs, const uint64_t* state,
+        const unsigned long lower_bound, const unsigned long bound) noexcept {
+    unsigned long min_dist = ULONG_MAX;
+    lane_counter counter;
+
+    for (unsigned long block = 0; block < beliefs.block_count; ++block) {
+        const unsigned long cap = std::min(min_dist - 1, bound);
+        if (!block_distances(beliefs, block, state, cap, counter)) {
+            continue;
+        }
+
+        uint64_t candidates[vertical_block_words];
+        lanes_within(counter, beliefs.counter_bits, cap, candidates);
+
+        const uint64_t* valid = beliefs.valid_lanes(block);
+        uint64_t any = 0;
+        for (unsigned long w = 0; w < vertical_block_words; ++w) {
+            candidates[w] &= valid[w];
+            any |= candidates[w];
+        }
+        if (!any) {
+            continue;
+        }
+
+        min_dist = lane_minimum(counter, beliefs.counter_bits, candidates);
+        if (min_dist <= lower_bound) {
+            return min_dist;
+        }
+    }
+
+    return min_dist;
+}
+
+min_collector vertical_collect_min_distances(const packed_states& formula,
+        const vertical_beliefs& beliefs, const unsigned long lower_bound) noexcept {
+    assert(!formula.is_cubes());
+    assert(formula.state_length == beliefs.state_length);
+
+    min_collector output;
+    std::atomic<unsigned long> shared_bound{ULONG_MAX};
+
+#pragma omp parallel
+    {
+        min_collector local;
+
+#pragma omp for schedule(dynamic, 64) nowait
+        for (unsigned long i = 0; i < formula.size; ++i) {
+            const unsigned long dist = vertical_min_distance(beliefs, formula.row(i), lower_bound,
+                    shared_bound.load(std::memory_order_relaxed));
+            local.add(dist, i);
+
+            lower_shared_bound(shared_bound, dist);
+        }
+
+#pragma omp critical(collector_merge)
+        output.merge(local);
+    }
+
+    return output;
+}
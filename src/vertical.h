@@ -0,0 +1,50 @@
+#ifndef VERTICAL_H
+#define VERTICAL_H
+
+#include <climits>
+#include <cstdint>
+#include <vector>
+
+#include "distance.h"
+#include "packed.h"
+
+//Number of 64-bit lane words per block, so a block holds 256 beliefs that are scored together
+constexpr unsigned long vertical_block_words = 4;
+constexpr unsigned long vertical_block_size = vertical_block_words * 64;
+
+//Belief set stored transposed, with one bit-plane per variable across each block of beliefs
+//Belief b of a block is lane b, held in bit (b % 64) of word (b / 64) of each of the block's planes
+//Distances to a whole block are summed with bit-sliced counters, so narrow states against a tall belief set
+//cost a few word operations per variable rather than a popcount per belief
+struct vertical_beliefs {
+    unsigned long state_length = 0;
+    unsigned long size = 0;
+    unsigned long block_count = 0;
+    //Number of counter bits needed to hold any distance up to state_length
+    unsigned long counter_bits = 0;
+    //Block-major, with the planes of each block stored one variable after another
+    std::vector<uint64_t> planes;
+    //Lanes of each block that hold a belief, since the last block is usually only partly filled
+    std::vector<uint64_t> valid;
+
+    const uint64_t* plane(const unsigned long block, const unsigned long variable) const noexcept {
+        return planes.data() + (block * state_length + variable) * vertical_block_words;
+    }
+    const uint64_t* valid_lanes(const unsigned long block) const noexcept {
+        return valid.data() + block * vertical_block_words;
+    }
+};
+
+//Transposes the belief set into bit-planes, which must hold full states rather than cubes
+vertical_beliefs build_vertical_beliefs(const packed_states& beliefs) noexcept;
+
+//Minimum distance between a single state and the transposed beliefs, one block at a time
+//Stops once the minimum reaches lower_bound, and any result above bound is only known to be above it
+unsigned long vertical_min_distance(const vertical_beliefs& beliefs, const uint64_t* state,
+        const unsigned long lower_bound = 0, const unsigned long bound = ULONG_MAX) noexcept;
+
+//Bit-sliced equivalent of collect_min_distances, where the formula must hold full states
+min_collector vertical_collect_min_distances(const packed_states& formula,
+        const vertical_beliefs& beliefs, const unsigned long lower_bound = 0) noexcept;
+
+#endif
@@ -0,0 +1,33 @@
+#!/bin/sh
+# Checks that a failing All-SAT solver is reported as an error, instead of being read as a formula with no models
+# Runs belief_rev against a stand-in solver that gets killed, the way an out of memory solver would
+# Usage: solver_failure.sh <path to belief_rev>
+
+binary=$1
+work=$(mktemp -d)
+trap 'rm -rf "$work"' EXIT
+
+mkdir "$work/minisat_all"
+cat > "$work/minisat_all/bdd_minisat_all_release" <<'SOLVER'
+#!/bin/sh
+kill -9 $$
+SOLVER
+chmod +x "$work/minisat_all/bdd_minisat_all_release"
+
+printf 'p raw\nA5\n' > "$work/beliefs.txt"
+printf 'p cnf 8 2\n1 2 0\n-3 0\n' > "$work/formula.txt"
+
+failures=0
+
+for engine in sat enumerate; do
+    if (cd "$work" && "$binary" -b beliefs.txt -f formula.txt -e "$engine" >stdout.txt 2>stderr.txt); then
+        echo "engine $engine: succeeded even though the solver was killed"
+        failures=$((failures + 1))
+    elif ! grep -q "All-SAT solver failed" "$work/stderr.txt"; then
+        echo "engine $engine: the solver failure was not reported"
+        cat "$work/stderr.txt"
+        failures=$((failures + 1))
+    fi
+done
+
+exit "$failures"